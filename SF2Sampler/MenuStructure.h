@@ -357,6 +357,16 @@ std::vector<MenuItem> createChannelMenu(Synth& synth, uint8_t channelIdx) {
             [&synth, channelIdx]() { return synth.channels[channelIdx].filterResonance * 100.0f / FILTER_MAX_Q; },
             [&synth, channelIdx](int v) { synth.channels[channelIdx].filterResonance = FILTER_MAX_Q * (float)(v + 0.5f) / 100.0f; synth.channels[channelIdx].recalcFilter(); },
             0, 100, 1),
+
+        MenuItem::Value("Max Voices",
+            [&synth, channelIdx]() { return synth.channels[channelIdx].maxVoices; },
+            [&synth, channelIdx](int v) { synth.setVoiceLimits(channelIdx, v, synth.channels[channelIdx].reservedVoices); },
+            0, MAX_VOICES, 1),
+
+        MenuItem::Value("Reserved",
+            [&synth, channelIdx]() { return synth.channels[channelIdx].reservedVoices; },
+            [&synth, channelIdx](int v) { synth.setVoiceLimits(channelIdx, synth.channels[channelIdx].maxVoices, v); },
+            0, MAX_VOICES / 2, 1),
             
         MenuItem::Action("Reset",
             [&synth, channelIdx](TextGUI&) { synth.channels[channelIdx].reset(); })
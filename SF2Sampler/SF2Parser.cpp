@@ -25,6 +25,7 @@
 #include "SF2Parser.h"
 #include "esp_log.h"
 #include "operators.h"
+#include <algorithm>
 
 extern SdFs SD;  // main.cpp’de global var
 
@@ -134,6 +135,9 @@ bool SF2Parser::parse() {
     }
 
     file.close();
+#ifdef ENABLE_HOT_SAMPLES
+    if (loadPlayCounts()) placeHotSamples();
+#endif
     return true;
 }
 
@@ -463,9 +467,68 @@ std::vector<Zone> SF2Parser::getZonesForNote(uint8_t note, uint8_t velocity, uin
         }
     }
 
+#ifdef ENABLE_LINKED_STEREO
+    if (resultZones.size() > 1) mergeStereoPairs(resultZones);
+#endif
+
     return resultZones;
 }
 
+// Left + right zones of a linked pair that differ only in sample and pan → one stereo zone.
+// Anything else (different envelopes, tuning, loop points...) stays two independent voices.
+bool SF2Parser::stereoCompatible(const Zone& l, const Zone& r) {
+    const SampleHeader* sl = l.sample;
+    const SampleHeader* sr = r.sample;
+    if (sl->sampleRate != sr->sampleRate || sl->pitchCorrection != sr->pitchCorrection) return false;
+    if (sl->end - sl->start != sr->end - sr->start) return false;
+    if (sl->startLoop - sl->start != sr->startLoop - sr->start) return false;
+    if (sl->endLoop   - sl->start != sr->endLoop   - sr->start) return false;
+    if (!sl->data || !sr->data) return false;
+
+    if (l.rootKey != r.rootKey || l.sampleModes != r.sampleModes || l.exclusiveClass != r.exclusiveClass) return false;
+    if (l.loopStartOffset != r.loopStartOffset || l.loopEndOffset != r.loopEndOffset ||
+        l.loopStartCoarseOffset != r.loopStartCoarseOffset || l.loopEndCoarseOffset != r.loopEndCoarseOffset) return false;
+
+    static constexpr float Zone::* same[] = {
+        &Zone::fineTune, &Zone::coarseTune,
+        &Zone::attackTime, &Zone::holdTime, &Zone::decayTime, &Zone::sustainLevel, &Zone::releaseTime,
+        &Zone::attenuation,
+        &Zone::modAttackTime, &Zone::modHoldTime, &Zone::modDecayTime, &Zone::modSustainLevel, &Zone::modReleaseTime,
+        &Zone::modEnvToPitch, &Zone::modEnvToFilterFc,
+        &Zone::vibLfoFreq, &Zone::vibLfoDelay, &Zone::vibLfoToPitch,
+        &Zone::modLfoFreq, &Zone::modLfoDelay, &Zone::modLfoToPitch, &Zone::modLfoToVolume, &Zone::modLfoToFilterFc,
+        &Zone::filterFc, &Zone::filterQ, &Zone::reverbSend, &Zone::chorusSend
+    };
+    for (auto m : same) {
+        if (l.*m != r.*m) return false;
+    }
+    return true;
+}
+
+void SF2Parser::mergeStereoPairs(std::vector<Zone>& zones) {
+    for (size_t i = 0; i < zones.size(); ++i) {
+        Zone& l = zones[i];
+        if (!l.sample || l.sampleR || !(l.sample->sampleType & 4)) continue;     // 4 = leftSample
+        if (l.sample->sampleLink >= samples.size()) continue;
+        const SampleHeader* partner = &samples[l.sample->sampleLink];
+
+        for (size_t j = 0; j < zones.size(); ++j) {
+            const Zone& r = zones[j];
+            if (j == i || r.sample != partner || !(r.sample->sampleType & 2)) continue;   // 2 = rightSample
+            if (!stereoCompatible(l, r)) break;
+
+            // Pan works as balance on the pair: hard L/R stays a full-width image
+            l.sampleR = r.sample;
+            l.pan     = 0.5f * (l.pan + r.pan);
+            ESP_LOGD(TAG, "Stereo pair: %s + %s", l.sample->name, r.sample->name);
+
+            zones.erase(zones.begin() + j);
+            if (j < i) --i;
+            break;
+        }
+    }
+}
+
 
 
 
@@ -532,6 +595,9 @@ void SF2Parser::applyGenerators(const std::vector<Generator>& gens, Zone& zone)
             case GeneratorOperator::AttackModEnv:
                 zone.modAttackTime = timecentsToSec(val);
                 break;
+            case GeneratorOperator::HoldModEnv:
+                zone.modHoldTime = timecentsToSec(val);
+                break;
             case GeneratorOperator::DecayModEnv:
                 zone.modDecayTime = timecentsToSec(val);
                 break;
@@ -541,6 +607,9 @@ void SF2Parser::applyGenerators(const std::vector<Generator>& gens, Zone& zone)
             case GeneratorOperator::ModEnvToPitch:
                 zone.modEnvToPitch = val;
                 break;
+            case GeneratorOperator::ModEnvToFilterFc:
+                zone.modEnvToFilterFc = val;  // in cents
+                break;
             case GeneratorOperator::SustainModEnv:
                // zone.modSustainLevel = powf(10.0f, -val / 200.0f);  // val is in centibels
                 zone.modSustainLevel = val * 0.001f ;  // map to 0..1
@@ -576,7 +645,7 @@ void SF2Parser::applyGenerators(const std::vector<Generator>& gens, Zone& zone)
                 zone.modLfoToFilterFc = val;  // in cents
                 break;
             case GeneratorOperator::ModLfoToVolume:
-                zone.modLfoToVolume = powf(10.0f, -val / 200.0f);  // in centibels
+                zone.modLfoToVolume = val;  // in centibels, applied bipolar by the voice
                 break;
             case GeneratorOperator::ModLfoDelay:
                 zone.modLfoDelay = timecentsToSec(val);;
@@ -721,6 +790,7 @@ bool SF2Parser::loadSampleDataToMemory() {
                 s.pitchCorrection = fallback->pitchCorrection;
                 s.sampleLink = fallback->sampleLink;
                 s.sampleType = fallback->sampleType;
+                s.peak = fallback->peak;
 
                 ESP_LOGW(TAG, "Sample %zu (%s) will use fallback sample", i, s.name);
                 continue;
@@ -734,6 +804,15 @@ bool SF2Parser::loadSampleDataToMemory() {
         file.read((uint8_t*)s.data, length * 2);
         s.dataSize = length * 2;
 
+        // Peak metadata for voice level tracking
+        const int16_t* pcm = (const int16_t*)s.data;
+        int32_t pk = 0;
+        for (uint32_t j = 0; j < length; ++j) {
+            const int32_t a = abs((int32_t)pcm[j]);
+            if (a > pk) pk = a;
+        }
+        s.peak = (float)pk * (1.0f / 32768.0f);
+
         ESP_LOGD(TAG, "Loaded sample %zu: %s (offset=%u length=%u)", i, s.name, s.start, length);
 
         if (!fallback)
@@ -745,14 +824,106 @@ bool SF2Parser::loadSampleDataToMemory() {
 
 
 
+#ifdef ENABLE_HOT_SAMPLES
+// ---- Profile-guided placement: en çok çalınan sample'ların atakları iç RAM'de ----
+// <sf2>.hot: "SFHC", sample sayısı, sonra sample başına uint32 çalınma sayısı
+
+static const uint32_t HOT_MAGIC = 0x43484653;   // "SFHC"
+
+bool SF2Parser::loadPlayCounts() {
+    FsFile f;
+    const String path = filepath + ".hot";
+    if (!f.open(path.c_str(), O_RDONLY)) return false;      // henüz profil yok
+
+    uint32_t hdr[2] = {0, 0};
+    bool ok = f.read(hdr, sizeof(hdr)) == (int)sizeof(hdr) && hdr[0] == HOT_MAGIC && hdr[1] == samples.size();
+    for (size_t i = 0; ok && i < samples.size(); ++i) {
+        uint32_t c;
+        ok = f.read(&c, sizeof(c)) == (int)sizeof(c);
+        samples[i].plays = c;
+    }
+    f.close();
+    if (!ok) {
+        ESP_LOGW(TAG, "%s does not match this file, play counts restart", path.c_str());
+        for (auto& s : samples) s.plays = 0;
+    }
+    return ok;
+}
+
+bool SF2Parser::savePlayCounts() {
+    uint32_t total = 0;
+    for (const auto& s : samples) total += s.plays;
+    if (total == 0) return false;
+
+    FsFile f;
+    const String path = filepath + ".hot";
+    if (!f.open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC)) {
+        ESP_LOGE(TAG, "Can't write %s", path.c_str());
+        return false;
+    }
+    const uint32_t hdr[2] = {HOT_MAGIC, (uint32_t)samples.size()};
+    f.write(hdr, sizeof(hdr));
+    for (const auto& s : samples) {
+        const uint32_t c = s.plays;     // packed struct: no pointer into it
+        f.write(&c, sizeof(c));
+    }
+    f.close();
+    ESP_LOGI(TAG, "Saved play counts of %u samples (%u note starts) to %s", (unsigned)samples.size(), total, path.c_str());
+    return true;
+}
+
+void SF2Parser::placeHotSamples() {
+    const size_t freeInternal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    size_t budget = HOT_SAMPLE_BUDGET;
+    if (freeInternal < HOT_RAM_RESERVE + budget)
+        budget = (freeInternal > HOT_RAM_RESERVE) ? freeInternal - HOT_RAM_RESERVE : 0;
+
+    std::vector<uint16_t> order;
+    for (size_t i = 0; i < samples.size(); ++i)
+        if (samples[i].plays > 0 && samples[i].data) order.push_back((uint16_t)i);
+    std::sort(order.begin(), order.end(),
+              [this](uint16_t a, uint16_t b) { return samples[a].plays > samples[b].plays; });
+
+    int placed = 0;
+    for (uint16_t i : order) {
+        SampleHeader& s = samples[i];
+        const uint32_t length = s.dataSize / sizeof(int16_t);
+        uint32_t n = (uint32_t)((uint64_t)s.sampleRate * HOT_ATTACK_MS / 1000);
+        if (n > length) n = length;
+        const size_t bytes = n * sizeof(int16_t);
+        if (n == 0 || hotBytes + bytes > budget) continue;      // sığmayan atlanır, küçükler denenir
+
+        s.hot = (int16_t*)heap_caps_aligned_alloc(4, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!s.hot) break;
+        memcpy(s.hot, s.data, bytes);
+        s.hotLen  = n;
+        hotBytes += bytes;
+        placed++;
+    }
+    ESP_LOGI(TAG, "Hot samples: %d of %u attacks (%d ms) in internal RAM, %u of %u bytes",
+             placed, (unsigned)order.size(), HOT_ATTACK_MS, (unsigned)hotBytes, (unsigned)budget);
+}
+#endif
+
 void SF2Parser::clear() {
+#ifdef ENABLE_HOT_SAMPLES
+    savePlayCounts();       // bu dosyanın profili sonraki yükleme için
+#endif
     for (auto& sample : samples) {
         if (sample.data) {
             heap_caps_free(sample.data);
             sample.data = nullptr;
             sample.dataSize = 0;
         }
+        if (sample.hot) {
+            heap_caps_free(sample.hot);
+            sample.hot = nullptr;
+            sample.hotLen = 0;
+        }
     }
+#ifdef ENABLE_HOT_SAMPLES
+    hotBytes = 0;
+#endif
 
     samples.clear();
     presets.clear();
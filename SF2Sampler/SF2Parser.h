@@ -28,6 +28,7 @@
 #include <FS.h>
 #include <vector>
 #include <map>
+#include "config.h"
 
 #include <SdFat.h>
 extern SdFs SD;
@@ -59,6 +60,10 @@ struct __attribute__((packed)) SampleHeader {
     uint16_t sampleType;
     uint8_t* data = nullptr;
     size_t dataSize = 0;
+    float peak = 1.0f;          // max |sample| / 32768, measured at load
+    int16_t* hot = nullptr;     // first hotLen frames copied to internal RAM (ENABLE_HOT_SAMPLES)
+    uint32_t hotLen = 0;
+    uint32_t plays = 0;         // note starts, persisted per SF2 file
     inline uint8_t getLoopMode() const {
         return sampleType & 0x0003;
     }
@@ -71,6 +76,7 @@ struct Zone {    // --- Обязательные параметры ---
     uint8_t keyLo = 0;
     uint8_t keyHi = 127;
     SampleHeader* sample = nullptr;
+    SampleHeader* sampleR = nullptr;   // linked right channel (stereo pair rendered by one voice), else nullptr
     
     // --- Генераторы из SF2 ---
     int rootKey = -1;          // OverridingRootKey (если нет → sample->originalPitch)
@@ -86,12 +92,16 @@ struct Zone {    // --- Обязательные параметры ---
     float sustainLevel = 1.0f; // SustainVolEnv (0.0–1.0)
     float releaseTime = 0.0f;  // ReleaseVolEnv
     float pan = 0.0f;          // Pan (-1.0–1.0)
+    float attenuation = 1.0f;
+
+    // Modulation envelope
     float modAttackTime = 0.0f;
-    float modReleaseTime = 0.0f;
+    float modHoldTime = 0.0f;
     float modDecayTime = -0.1f;
-    float modSustainLevel = 0.0f;
-    float attenuation = 1.0f;
-    float modEnvToPitch = 0.0f;
+    float modSustainLevel = 0.0f;     // 0.0 = full level, 1.0 = silent (SF2 "decrease")
+    float modReleaseTime = 0.0f;
+    float modEnvToPitch = 0.0f;       // cents
+    float modEnvToFilterFc = 0.0f;    // cents
 
     // Vibrato LFO (pitch modulation only)
     float vibLfoFreq = 0.0f;       // Hz
@@ -150,6 +160,10 @@ public:
     void dumpPresetStructure() ;
     bool hasPreset(uint16_t bank, uint16_t program) const ;
     void clear();
+#ifdef ENABLE_HOT_SAMPLES
+    bool   savePlayCounts();
+    size_t getHotBytes() const { return hotBytes; }
+#endif
 
 private:
     bool parseHeaderChunks();
@@ -162,6 +176,13 @@ private:
     uint32_t hashSampleName(const char* name) ;
     bool loadSampleDataToMemory();
     void applyGenerators(const std::vector<Generator>& gens, Zone& zone) ;
+    void mergeStereoPairs(std::vector<Zone>& zones);
+    static bool stereoCompatible(const Zone& l, const Zone& r);
+#ifdef ENABLE_HOT_SAMPLES
+    bool loadPlayCounts();
+    void placeHotSamples();
+    size_t hotBytes = 0;
+#endif
 
     FsFile      file;
     String      filepath;
@@ -12,6 +12,8 @@
 // Per-channel (ch = 0..15)
 #define PARAM_CHANNEL_BASE      0x1000
 #define PARAM_CHANNEL(i)        (PARAM_CHANNEL_BASE + (i))
+#define PARAM_CH_VOICES_BASE    0x1100  // 2 bytes: max voices, reserved voices
+#define PARAM_CH_VOICES(i)      (PARAM_CH_VOICES_BASE + (i))
 
 
 
@@ -4,8 +4,6 @@
 #include "adsr.h"
 #include <math.h>
 
-static const char* TAG = "ADSR";
-
 void Adsr::init(float sample_rate, int blockSize) {
     sample_rate_  = sample_rate / blockSize;
     attackShape_  = -1.f;
@@ -29,7 +27,22 @@ void Adsr::init(float sample_rate, int blockSize) {
 }
 
 
+// event_ is a lock word shared with processBlock(): even = free, odd = someone writes the state
+uint32_t Adsr::lockState() {
+  uint32_t e = __atomic_load_n(&event_, __ATOMIC_RELAXED);
+  for (;;) {
+    if (!(e & 1u) && __atomic_compare_exchange_n(&event_, &e, e + 1u, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return e;
+    e = __atomic_load_n(&event_, __ATOMIC_RELAXED);
+  }
+}
+
+void Adsr::unlockState(uint32_t e) {
+  __atomic_store_n(&event_, e + 2u, __ATOMIC_RELEASE);
+}
+
+
 void Adsr::retrigger(eEnd_t hardness) {
+  const uint32_t e = lockState();
   gate_ = true;
   mode_ = ADSR_SEG_ATTACK;
   switch (hardness) {
@@ -43,10 +56,12 @@ void Adsr::retrigger(eEnd_t hardness) {
     default:
       D0_ = attackD0_;
   }
+  unlockState(e);
 }
 
 
 void Adsr::end(eEnd_t hardness) {
+  const uint32_t e = lockState();
   gate_ = false;
   target_ = -0.1f;
   switch (hardness) {
@@ -72,6 +87,7 @@ void Adsr::end(eEnd_t hardness) {
       D0_ = releaseD0_;
     }
   }
+  unlockState(e);
 }
 
 
@@ -201,53 +217,108 @@ void Adsr::setTimeConstant(float timeInS, float& time, float& coeff) {
 }
 
 
-float __attribute__((hot, always_inline)) IRAM_ATTR Adsr::process() {
-  float out = 0.0f;
-  switch (mode_) {
-    case ADSR_SEG_IDLE:
-      out = 0.0f;
-      break;
-    case ADSR_SEG_ATTACK:
-      x_ += (float)D0_ * ((float)attackTarget_ - (float)x_);
-      out = x_;
-      if (out >= 1.f) {
-        x_ = out = 1.f;
-        if (holdSamples_ > 0) {
-            mode_ = ADSR_SEG_HOLD;
-            holdCounter_ = holdSamples_;
-        } else {
-            mode_ = ADSR_SEG_DECAY;
-            target_ = sus_level_;
-            D0_ = decayD0_;
+float __attribute__((hot)) IRAM_ATTR Adsr::process() {
+  // one step of the block renderer: same values, same event hand-off
+  float out;
+  processBlock(&out, 1);
+  return out;
+}
+
+
+void __attribute__((hot)) IRAM_ATTR Adsr::processBlock(float* out, int n) {
+  // retrigger()/end() may come from the other core while we render: take a consistent
+  // snapshot (event_ even and unchanged around it), render from registers and commit
+  // only if no event arrived meanwhile (the event state wins, the block result is dropped)
+  const uint32_t ev = __atomic_load_n(&event_, __ATOMIC_ACQUIRE);
+  float      x      = x_;
+  float      target = target_;
+  float      D0     = D0_;
+  eSegment_t mode   = mode_;
+  uint32_t   holdCnt = holdCounter_;
+  __sync_synchronize();
+  if ((ev & 1u) || ev != __atomic_load_n(&event_, __ATOMIC_RELAXED)) {
+    // an event is being written right now: hold the last value for this block
+    for (int i = 0; i < n; ++i) out[i] = x;
+    return;
+  }
+
+  int i = 0;
+  while (i < n) {
+    switch (mode) {
+      case ADSR_SEG_ATTACK: {
+        const float aT = attackTarget_;
+        for (; i < n; ++i) {
+          x += D0 * (aT - x);
+          if (x >= 1.f) {
+            x = 1.f;
+            out[i++] = 1.f;
+            if (holdSamples_ > 0) {
+              mode = ADSR_SEG_HOLD;
+              holdCnt = holdSamples_;
+            } else {
+              mode = ADSR_SEG_DECAY;
+              target = sus_level_;
+              D0 = decayD0_;
+            }
+            break;
+          }
+          out[i] = x;
         }
+        break;
       }
-      break;
-    case ADSR_SEG_HOLD:
-      out = x_;
-      if (holdCounter_ > 0) {
-          holdCounter_--;
-      } else {
-          mode_ = ADSR_SEG_DECAY;
-          target_ = sus_level_ - (x_ - sus_level_) * 0.1f;
-          D0_ = decayD0_;
+      case ADSR_SEG_HOLD: {
+        // holdCnt+1 samples of x, the last one switches to decay
+        const uint32_t left = (uint32_t)(n - i);
+        const uint32_t m    = (holdCnt < left) ? holdCnt + 1 : left;
+        for (uint32_t k = 0; k < m; ++k) out[i + k] = x;
+        i += m;
+        if (m == holdCnt + 1) {
+          holdCnt = 0;
+          mode = ADSR_SEG_DECAY;
+          target = sus_level_ - (x - sus_level_) * 0.1f;
+          D0 = decayD0_;
+        } else {
+          holdCnt -= m;
+        }
+        break;
       }
-      break;
-    case ADSR_SEG_DECAY:
-    case ADSR_SEG_RELEASE:
-    case ADSR_SEG_FAST_RELEASE:
-    case ADSR_SEG_SEMI_FAST_RELEASE:
-      x_ += (float)D0_ * ((float)target_ - (float)x_);
-      out = x_;
-      if (out < 0.0f) {
-        mode_ = ADSR_SEG_IDLE;
-        x_ = out = 0.f;
-        target_ = -0.1f;
-        D0_ = attackD0_;
+      case ADSR_SEG_DECAY:
+      case ADSR_SEG_RELEASE:
+      case ADSR_SEG_FAST_RELEASE:
+      case ADSR_SEG_SEMI_FAST_RELEASE: {
+        // settled (sustain): the recurrence is at its fixed point
+        if (x + D0 * (target - x) == x && x >= 0.0f) {
+          for (; i < n; ++i) out[i] = x;
+          break;
+        }
+        for (; i < n; ++i) {
+          x += D0 * (target - x);
+          if (x < 0.0f) {
+            mode = ADSR_SEG_IDLE;
+            x = 0.f;
+            out[i++] = 0.f;
+            target = -0.1f;
+            D0 = attackD0_;
+            break;
+          }
+          out[i] = x;
+        }
+        break;
       }
-      break;
-    default: 
-      break;
+      case ADSR_SEG_IDLE:
+      default:
+        for (; i < n; ++i) out[i] = 0.0f;
+        break;
+    }
   }
 
-  return out;
+  uint32_t e = ev;
+  if (__atomic_compare_exchange_n(&event_, &e, ev + 1u, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    x_           = x;
+    target_      = target;
+    D0_          = D0;
+    mode_        = mode;
+    holdCounter_ = holdCnt;
+    unlockState(ev);
+  }
 }
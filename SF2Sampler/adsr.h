@@ -48,9 +48,17 @@ enum eEnd_t { END_REGULAR, END_SEMI_FAST, END_FAST, END_NOW };
     void end(eEnd_t hardness);
 	
     /** Processes one sample through the filter and returns one sample.
+        Same as processBlock(&out, 1).
     */
     float process();
 
+    /** Renders n envelope samples into out[], same values as n calls of process().
+        Segment changes are found inside the block, every segment is filled by its own
+        tight loop (one-pole recurrence for attack/decay/releases, constant fill for
+        hold, idle and a settled sustain). State lives in registers for the whole block.
+    */
+    void processBlock(float* out, int n);
+
 	
     /** Sets time
         Set time per segment in seconds
@@ -65,6 +73,8 @@ enum eEnd_t { END_REGULAR, END_SEMI_FAST, END_FAST, END_NOW };
 
   private:
     void setTimeConstant(float timeInS, float& time, float& coeff);
+    uint32_t lockState();               // spins until event_ is even, makes it odd, returns the even value
+    void     unlockState(uint32_t e);   // event_ = e + 2
 
   public:
     /** Sustain level
@@ -92,15 +102,21 @@ enum eEnd_t { END_REGULAR, END_SEMI_FAST, END_FAST, END_NOW };
         \return true if the envelope is currently in any stage apart from idle.
     */
     inline bool isIdle() const { return mode_ == ADSR_SEG_IDLE; }
+    /** Tells whether the envelope can only fall from here on (decay, sustain, any release)
+    */
+    inline bool isDecaying() const { return mode_ >= ADSR_SEG_DECAY; }
+    /** Tells whether the envelope is in one of the release segments
+    */
+    inline bool isReleasing() const { return mode_ >= ADSR_SEG_RELEASE; }
 
     inline float getVal() const { return x_; }
     inline float getTarget() const { return target_; }
 
   private:
     float   sus_level_{0.f};
-    volatile float   x_{0.f};
-    volatile float   target_{0.f};
-    volatile float 	D0_{0.f};
+    float   x_{0.f};
+    float   target_{0.f};
+    float 	D0_{0.f};
     float   attackShape_{-1.f};
     float   attackTarget_{0.0f};
     float   attackTime_{-1.0f};
@@ -117,6 +133,7 @@ enum eEnd_t { END_REGULAR, END_SEMI_FAST, END_FAST, END_NOW };
     uint32_t holdSamples_ = 0; // how many samples to hold
     uint32_t holdCounter_ = 0; // current counter
     int     sample_rate_;
-    volatile eSegment_t mode_{ADSR_SEG_IDLE};
+    eSegment_t mode_{ADSR_SEG_IDLE};
     bool    gate_{false};
+    volatile uint32_t event_{0}; // lock word: odd while retrigger()/end() or a block commit writes the state
 };
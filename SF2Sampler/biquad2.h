@@ -140,13 +140,11 @@ private:
     }
 
     static BIQUAD_FORCE_INLINE CoeffsLUTEntry interpolateLUT(float freq, float Q) {
-        // Clamp inputs
-        if (freq < FreqMin) freq = FreqMin; else if (freq > FreqMax) freq = FreqMax;
-        if (Q    < QMin   ) Q    = QMin;    else if (Q    > QMax   ) Q    = QMax;
-
-        const float freqPos = (logf(freq) - logFreqMin) * invLogFreqRange * (FreqSteps - 1);
-        const float qPos    = (Q - QMin) / (QMax - QMin) * (QSteps - 1);
+        return interpolateLUTPos(freqToLutPos(freq), qToLutPos(Q));
+    }
 
+    // Bilinear lookup at fractional grid positions (already clamped to the grid)
+    static BIQUAD_FORCE_INLINE CoeffsLUTEntry interpolateLUTPos(float freqPos, float qPos) {
         const size_t fi0 = (size_t)freqPos;
         const size_t qi0 = (size_t)qPos;
         const size_t fi1 = (fi0 + 1 < FreqSteps) ? fi0 + 1 : FreqSteps - 1;
@@ -242,6 +240,30 @@ public:
         if (!lutInitialized) generateLUT();
     }
 
+    // ---- LUT-space helpers for modulated LP filters ----
+    // A position is a fractional index into the LUT grid. Frequency positions are
+    // linear in log(freq), so a cutoff offset in cents is a plain multiply-add:
+    //   pos = freqToLutPos(fc) + cents * LutPosPerCent
+    // which keeps logf/expf/cosf/sinf out of the per-block audio path.
+    static constexpr float LutPosPerCent = 0.00057762265f * invLogFreqRange * (FreqSteps - 1); // ln(2)/1200
+
+    static BIQUAD_FORCE_INLINE float freqToLutPos(float freq) {
+        if (freq < FreqMin) freq = FreqMin; else if (freq > FreqMax) freq = FreqMax;
+        return (logf(freq) - logFreqMin) * invLogFreqRange * (FreqSteps - 1);
+    }
+
+    static BIQUAD_FORCE_INLINE float qToLutPos(float Q) {
+        if (Q < QMin) Q = QMin; else if (Q > QMax) Q = QMax;
+        return (Q - QMin) / (QMax - QMin) * (QSteps - 1);
+    }
+
+    static BIQUAD_FORCE_INLINE Coeffs calcLPAtLutPos(float freqPos, float qPos) {
+        if (freqPos < 0.0f) freqPos = 0.0f; else if (freqPos > float(FreqSteps - 1)) freqPos = float(FreqSteps - 1);
+        if (qPos    < 0.0f) qPos    = 0.0f; else if (qPos    > float(QSteps - 1))    qPos    = float(QSteps - 1);
+        const CoeffsLUTEntry c = interpolateLUTPos(freqPos, qPos);
+        return Coeffs{c.b0, c.b1, c.b2, c.a1, c.a2};
+    }
+
     static Coeffs calcCoeffs(float freq, float Q, Mode mode) {
         // For LP use LUT (+bilinear interpolation). Others: compute directly (rarely called).
         if (mode == LowPass) {
@@ -399,10 +421,37 @@ public:
     BIQUAD_FORCE_INLINE void resetState() {
         x1 = x2 = y1 = y2 = 0.0f;
         w1 = w2 = z1 = z2 = 0.0f;
+        rampLeft = 0;
+    }
+
+    // Sets LP coefficients directly (no ramp). The LUT must be initialized (BiquadCalc::ensureLUT()).
+    BIQUAD_FORCE_INLINE void setLutPos(float freqPos, float qPos) {
+        coeffs   = BiquadCalc::calcLPAtLutPos(freqPos, qPos);
+        rampLeft = 0;
+    }
+
+    // Glides linearly from the current LP coefficients to the ones at (freqPos, qPos)
+    // over n calls of process(). Linear blending of two stable 2nd order sections stays
+    // stable (the a1/a2 stability triangle is convex), and it removes zipper noise
+    // from per-block cutoff modulation.
+    BIQUAD_FORCE_INLINE void rampToLutPos(float freqPos, float qPos, uint32_t n) {
+        const Coeffs t = BiquadCalc::calcLPAtLutPos(freqPos, qPos);
+        const float k  = 1.0f / (float)n;
+        dCoeffs.b0 = (t.b0 - coeffs.b0) * k;
+        dCoeffs.b1 = (t.b1 - coeffs.b1) * k;
+        dCoeffs.b2 = (t.b2 - coeffs.b2) * k;
+        dCoeffs.a1 = (t.a1 - coeffs.a1) * k;
+        dCoeffs.a2 = (t.a2 - coeffs.a2) * k;
+        rampLeft   = n;
     }
 
     // Mono
     BIQUAD_FORCE_INLINE float BIQUAD_IRAM process(float in) {
+        if (rampLeft) {
+            coeffs.b0 += dCoeffs.b0; coeffs.b1 += dCoeffs.b1; coeffs.b2 += dCoeffs.b2;
+            coeffs.a1 += dCoeffs.a1; coeffs.a2 += dCoeffs.a2;
+            --rampLeft;
+        }
         const float lx1 = x1, lx2 = x2, ly1 = y1, ly2 = y2;
         const float out = (coeffs.b0 * in) + (coeffs.b1 * lx1 + coeffs.b2 * lx2)
                           - (coeffs.a1 * ly1 + coeffs.a2 * ly2);
@@ -414,6 +463,11 @@ public:
     // Stereo LR in-place
     BIQUAD_FORCE_INLINE void BIQUAD_IRAM processLR(float* __restrict inOutL,
                                                    float* __restrict inOutR) {
+        if (rampLeft) {
+            coeffs.b0 += dCoeffs.b0; coeffs.b1 += dCoeffs.b1; coeffs.b2 += dCoeffs.b2;
+            coeffs.a1 += dCoeffs.a1; coeffs.a2 += dCoeffs.a2;
+            --rampLeft;
+        }
         // Left
         float lx1 = x1, lx2 = x2, ly1 = y1, ly2 = y2;
         const float inL  = *inOutL;
@@ -463,13 +517,16 @@ public:
 
 private:
     void updateCoeffs() {
-        coeffs = BiquadCalc::calcCoeffs(freq, Q, mode);
+        coeffs   = BiquadCalc::calcCoeffs(freq, Q, mode);
+        rampLeft = 0;
     }
 
     BiquadCalc::Mode mode = BiquadCalc::LowPass;
     float freq = 20000.0f;
     float Q    = 0.707f;
     Coeffs coeffs{};
+    Coeffs dCoeffs{};       // per-sample ramp step (see rampToLutPos)
+    uint32_t rampLeft = 0;
 
     // States
     float x1 = 0.0f, x2 = 0.0f, y1 = 0.0f, y2 = 0.0f;
@@ -29,6 +29,9 @@
 #include "SF2Parser.h"
 #include "adsr.h"
 #include "biquad2.h"
+#include "svf.h"
+#include "tuning.h"
+#include "vib_lfo.h"
 
 float const activitySmoothingFactor = 0.9f;
 
@@ -43,6 +46,7 @@ struct DRAM_ATTR ChannelState {
     float pan = 0.5f;           // CC#10, 0.0 = left, 1.0 = right
     
     float modWheel = 0.0f;       // CC#1, 0.0–1.0
+    float brightness = 0.0f;     // CC#74, voice filter cutoff offset in cents (0 at 64)
     
     int portaCurrentNote = 60;
     
@@ -62,7 +66,12 @@ struct DRAM_ATTR ChannelState {
     float pitchBendFactor = 1.0f;  // derived from pitchBend and pitchBendRange
     
     // Tuning
-    float tuningSemitones = 0.0f;
+    float tuningSemitones = 0.0f;   // XG note shift, folded into tuning.ratio()
+    TuningTable tuning;             // per-key ratio against 12-TET (MTS / Scala), survives reset()
+
+#ifdef ENABLE_SHARED_VIB_LFO
+    VibLfoBank vibLfo;              // shared vibrato LFOs, stepped per block in Synth::renderLRBlock()
+#endif
     
     // Pedals
     uint32_t sustainPedal = false;  // CC#64
@@ -86,6 +95,10 @@ struct DRAM_ATTR ChannelState {
     enum MonoMode : uint8_t { Poly = 0, MonoLegato = 1, MonoRetrig = 2 };
     MonoMode monoMode = Poly;
 
+    // Voice limits (Synth::setVoiceLimits), kept over reset()
+    uint8_t maxVoices      = 0;     // polyphony cap, 0 = none
+    uint8_t reservedVoices = 0;     // voices other channels may not steal
+
     std::array<uint8_t, 8> noteStack = {};  
     uint8_t stackSize = 0;
 
@@ -136,7 +149,7 @@ struct DRAM_ATTR ChannelState {
     }
 
 #ifdef ENABLE_CH_FILTER
-    BiquadFilterInternalCoeffs filter;
+    ChannelFilter filter;
 
     // Filter parameters
     float filterCutoff = 20000.0f;  // default no filtering
@@ -158,20 +171,22 @@ struct DRAM_ATTR ChannelState {
 
 #elif defined(ENABLE_CH_FILTER_M)
     
-    BiquadCalc::Coeffs  filterCoeffs;
+    FilterCalc::Coeffs  filterCoeffs;
     
     // Filter parameters
     float filterCutoff = 20000.0f;  // default no filtering
     float filterResonance = 0.707f;
+    bool  filterOpen = true;        // default settings: voices skip the channel filter
 
     inline void updateFilter(float cutoff, float resonance) {
         filterCutoff = cutoff;
         filterResonance = resonance;
-        filterCoeffs = BiquadCalc::calcCoeffs(cutoff, resonance, BiquadCalc::LowPass);
+        recalcFilter();
     }
 	
     inline void recalcFilter() {
-        filterCoeffs = BiquadCalc::calcCoeffs(filterCutoff, filterResonance, BiquadCalc::LowPass);
+        filterCoeffs = FilterCalc::calcCoeffs(filterCutoff, filterResonance, BiquadCalc::LowPass);
+        filterOpen   = (filterCutoff >= 20000.0f) && (filterResonance <= 0.7072f);
     }
     
     inline void resetFilter() {
@@ -197,6 +212,7 @@ struct DRAM_ATTR ChannelState {
         pitchBendRange = 2.0f;     // Default
         pitchBendFactor = 1.0f; // No pitch bend
         modWheel = 0.0f;
+        brightness = 0.0f;
         reverbSend = 0.05f; // CC#91
         chorusSend = 0.0f;  // CC#93
         delaySend = 0.0f;   // CC#95
@@ -206,6 +222,7 @@ struct DRAM_ATTR ChannelState {
         attackModifier = 1.0f;  // CC#73
         releaseModifier = 1.0f; // CC#72
         tuningSemitones = 0.0f; //
+        tuning.setShift(0.0f);
         monoMode = Poly;
         clearNoteStack() ;
 #if defined(ENABLE_CH_FILTER) || defined(ENABLE_CH_FILTER_M)
@@ -37,23 +37,89 @@
 #define   NUM_MIDI_CHANNELS		16
 
 // ===================== SYNTHESIZER ================================================================================
-#define MAX_VOICES 19 // for now 20 is max for per-channel filtering + chorus + reverb
+//#define ENABLE_DUAL_CORE_RENDER       // uncomment to split voice rendering between both cores (~1.8x polyphony)
+#ifdef ENABLE_DUAL_CORE_RENDER
+  #define MAX_VOICES 34
+#else
+  #define MAX_VOICES 19 // for now 20 is max for per-channel filtering + chorus + reverb
+#endif
+#if MAX_VOICES > 64
+  #error "MAX_VOICES is limited to 64: voice_index.h keeps the slots of a channel / note in one 64-bit mask"
+#endif
 #define MAX_VOICES_PER_NOTE 2
+#define GHOST_VOICES 4        // extra fade-out slots for stolen voices (one block ~2.9 ms fade) = steals per block without a hard cut, 0 disables
+#define EXCLUSIVE_CHOKE_MS    20  // release time of voices cut by an exclusive class (open/closed hi-hat etc.)
+#define CHOKE_CLASSES_PER_CH  4   // exclusive classes tracked per channel (voice_index.h), more fall back to a scan
+#define ENABLE_SHARED_VIB_LFO     // vibrato LFO stepped once per channel (vib_lfo.h), voices only read it
+#define VIB_LFO_SLOTS         4   // distinct vibrato rate/depth pairs per channel, more use a private LFO
+#define VOICE_STEAL_POLICY  STEAL_RELEASE_FIRST   // STEAL_QUIETEST, STEAL_OLDEST, STEAL_RELEASE_FIRST or STEAL_SAME_NOTE (voice_alloc.h)
 #define PITCH_BEND_CENTER 0
 
 #define ENABLE_IN_VOICE_FILTERS       // comment this out to disable voice SF2 filters
 //#define ENABLE_REVERB                 // comment this out to disable reverb 
+//#define REVERB_HALF_RATE              // reverb tank at SAMPLE_RATE/2 (half-band down/up): ~half the reverb CPU and memory, tail band-limited to ~10 kHz
+//#define ENABLE_CONV_REVERB            // convolution reverb on the reverb send (fx_convolver.h, see its cost table); needs ENABLE_REVERB, which runs until an IR is loaded
+#define CONV_IR_MAX_MS        1000    // longer impulse responses are truncated (~3 KB PSRAM per 2.9 ms)
 #define ENABLE_CHORUS                 // comment this out to disable chorus
 #define ENABLE_CH_FILTER_M           // uncomment this line to mono per-channel filtering before stereo split
+//#define ENABLE_SVF_FILTERS           // uncomment to use TPT state-variable filters (svf.h) instead of biquads for voice/channel filters
 //#define ENABLE_DELAY                  // comment this out to disable delay
 //#define ENABLE_OVERDRIVE             // comment this out to disable overdrive effect
 //#define ENABLE_CH_FILTER             // not recommended, use ENABLE_CH_FILTER_M instead 
+//#define ENABLE_FX_PIPELINE           // uncomment to run effects + master on core 0, one block (2.9 ms) behind the voices
 
 #define CH_FILTER_MAX_FREQ 12000.0f
 #define CH_FILTER_MIN_FREQ 50.0f
 #define FILTER_MAX_Q 7.0f
+// CC#74 has one destination: voice filter brightness when the voice filters are built, else the
+// channel filter cutoff as before. With voice filters the channel cutoff moves to its own controller
+// (CC#71 stays channel filter resonance).
+#ifdef ENABLE_IN_VOICE_FILTERS
+  #define CH_FILTER_CUTOFF_CC 102     // undefined in the MIDI spec, free for a knob
+#else
+  #define CH_FILTER_CUTOFF_CC 74
+#endif
+
+#define VOICE_FILTER_VEL_CENTS  -2400.0f  // SF2 default modulator: velocity -> voice filter cutoff at vel=0 (0 disables)
+#define VOICE_FILTER_CC74_CENTS  2400.0f  // CC#74 brightness range on voice filters, +/- cents around 64 (0 disables)
+#define VOICE_FILTER_BYPASS_HZ  13500.0f  // zone cutoff at/above this (no Q, no mod routed) skips the voice filter
+// 13500 Hz is what the parser keeps for zones without InitialFilterFc (SF2: 13500 cents, fully open),
+// so GM sets that never touch the filter run without it. Velocity is not applied to such open zones;
+// CC74 below 64 still switches the filter on.
+
+#define ENABLE_VOICE_RETIRE           // free released voices whose output fell below the threshold (held notes are kept)
+#define VOICE_RETIRE_DBFS     -90.0f  // output-referred level (16-bit floor is ~-96 dBFS)
+#define VOICE_RETIRE_BLOCKS   8       // consecutive quiet blocks before the voice is freed (8 x 2.9 ms)
+
+#define ENABLE_POLY_GOVERNOR          // lower quality/polyphony when the render load nears the block deadline
+#define GOV_CPU_MHZ           240     // CPU clock the deadline is measured in
+#define GOV_HIGH_LOAD         0.85f   // smoothed render load (1.0 = whole block time) that triggers a step down
+#define GOV_LOW_LOAD          0.60f   // load under which a step is restored
+#define GOV_HOLD_BLOCKS       16      // blocks between two governor steps
+#define GOV_MIN_VOICES        8       // the voice cap never goes below this
+
+#define ENABLE_VIRTUAL_VOICES         // inaudible voices (CC7/CC11 at 0, tiny gain) keep timing but skip rendering
+#define VOICE_VIRTUAL_DBFS    -96.0f  // output-referred level under which a block is not rendered
+// Virtual and retire thresholds are independent: retire only takes released voices, so a held
+// note silenced by CC7/CC11 stays virtual and resumes on a swell. A released voice below
+// VOICE_RETIRE_DBFS is freed whether it is virtual or not.
+
+#define ENABLE_LINKED_STEREO          // SF2 left/right linked sample pairs play as one stereo voice
+#define ENABLE_MICROTUNING            // MTS SysEx + Scala .scl/.kbm per-channel 128-key tuning tables (512 B per channel)
+#define SCALA_MAX_NOTES       128     // longest accepted .scl scale
+
+//#define ENABLE_SAMPLE_PREFETCH        // copy the sample span of each voice-block PSRAM -> DRAM before interpolating
+#define VOICE_PREFETCH_LEN    1024    // samples per channel; longer spans (increment > ~7.9) read PSRAM directly
+
+#define ENABLE_HOT_SAMPLES            // attacks of the most played samples (counts kept on SD as <sf2>.hot) live in internal RAM
+#define HOT_SAMPLE_BUDGET     (48 * 1024)   // bytes of internal RAM for attack copies
+#define HOT_ATTACK_MS         60            // attack length copied per sample
+#define HOT_RAM_RESERVE       (96 * 1024)   // internal RAM always left to the system, whatever the budget
 
 static const char* SF2_PATH = "/sf2"; 
+static const char* SCALA_PATH = "/tuning";  // .scl / .kbm files for Synth::loadScala()
+static const char* CONV_IR_PATH = "/ir";    // impulse response .wav files for FxConvolver::loadWav()
+#define CONV_IR_FILE "default.wav"          // loaded at startup with ENABLE_CONV_REVERB
 #define DEFAULT_CONFIG_FILE "/default_config.bin"
 // ===================== MIDI PINS ==================================================================================
 #define MIDI_IN         15      // if USE_MIDI_STANDARD is selected as MIDI_IN, this pin receives MIDI messages
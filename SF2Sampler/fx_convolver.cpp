@@ -0,0 +1,355 @@
+/*
+ * ----------------------------------------------------------------------------
+ * ESP32-S3 SF2 Synthesizer Firmware
+ *
+ * Author: Evgeny Aslovskiy AKA Copych
+ * License: MIT
+ * Repository: https://github.com/copych/ESP32-S3_SF2_Sampler_Synthesizer
+ *
+ * File: fx_convolver.cpp
+ * Purpose: partitioned convolution engine, FFT backends and WAV impulse loading
+ * ----------------------------------------------------------------------------
+ */
+
+#include "fx_convolver.h"
+
+#ifdef ENABLE_CONV_REVERB
+
+#include <SdFat.h>
+#include "misc.h"
+#ifdef ESP_PLATFORM
+#include <esp_dsp.h>
+#endif
+
+static const char* TAG = "Convolver";
+
+#ifdef BOARD_HAS_PSRAM
+  #define CONV_MALLOC_CAP MALLOC_CAP_SPIRAM
+#else
+  #define CONV_MALLOC_CAP MALLOC_CAP_INTERNAL
+#endif
+
+// ================================================================================================
+// FFT
+
+#ifdef ESP_PLATFORM
+
+bool FxConvolver::initFft() {
+    const esp_err_t err = dsps_fft2r_init_fc32(nullptr, CONFIG_DSP_MAX_FFT_SIZE);
+    if (err != ESP_OK && err != ESP_ERR_DSP_REINITIALIZED) {
+        ESP_LOGE(TAG, "esp-dsp FFT init failed (%d)", (int)err);
+        return false;
+    }
+    return true;
+}
+
+void IRAM_ATTR FxConvolver::fft(float* data) {
+    dsps_fft2r_fc32(data, CONV_FFT);
+    dsps_bit_rev_fc32(data, CONV_FFT);
+}
+
+#else
+
+// Portable radix-2 (host builds): bit reversal, then in-place butterflies
+static float convTwiddle[CONV_FFT];      // cos, -sin of 2πk/N for k < N/2
+
+bool FxConvolver::initFft() {
+    for (int k = 0; k < CONV_FFT / 2; ++k) {
+        convTwiddle[2 * k]     =  cosf(2.0f * (float)M_PI * k / CONV_FFT);
+        convTwiddle[2 * k + 1] = -sinf(2.0f * (float)M_PI * k / CONV_FFT);
+    }
+    return true;
+}
+
+void FxConvolver::fft(float* data) {
+    for (int i = 1, j = 0; i < CONV_FFT; ++i) {
+        int bit = CONV_FFT >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            float t = data[2 * i];     data[2 * i]     = data[2 * j];     data[2 * j]     = t;
+            t       = data[2 * i + 1]; data[2 * i + 1] = data[2 * j + 1]; data[2 * j + 1] = t;
+        }
+    }
+    for (int len = 2; len <= CONV_FFT; len <<= 1) {
+        const int half = len >> 1, step = CONV_FFT / len;
+        for (int i = 0; i < CONV_FFT; i += len) {
+            for (int k = 0; k < half; ++k) {
+                const float wr = convTwiddle[2 * k * step], wi = convTwiddle[2 * k * step + 1];
+                float* a = data + 2 * (i + k);
+                float* b = data + 2 * (i + k + half);
+                const float tr = b[0] * wr - b[1] * wi;
+                const float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;  b[1] = a[1] - ti;
+                a[0] += tr;        a[1] += ti;
+            }
+        }
+    }
+}
+
+#endif
+
+// ================================================================================================
+
+void FxConvolver::clear() {
+    // El sıkışma (processBlock ile ayna): önce ready = false, sonra busy okunur. İki taraf da
+    // yazdıktan sonra bariyer koyduğu için en az biri diğerinin yazısını görür: ya processBlock
+    // ready = false görüp belleğe dokunmaz, ya da biz busy'yi görüp blok bitene kadar bekleriz.
+    ready = false;
+    __sync_synchronize();
+    while (busy) vTaskDelay(1);
+    if (mem) heap_caps_free(mem);
+    mem = filt = fdl = nullptr;
+    parts = 0;
+    fdlPos = 0;
+}
+
+bool FxConvolver::setImpulse(const float* irL, const float* irR, int len) {
+    clear();
+    if (!irL || len <= 0) return false;
+    if (!irR) irR = irL;
+
+    const int maxLen = (int)((int64_t)CONV_IR_MAX_MS * SAMPLE_RATE / 1000);
+    if (len > maxLen) {
+        ESP_LOGW(TAG, "IR truncated to %d ms", CONV_IR_MAX_MS);
+        len = maxLen;
+    }
+    if (!initFft()) return false;
+
+    // 0 dB noise gain: mean channel energy = 1
+    double e = 0.0;
+    for (int i = 0; i < len; ++i) e += 0.5 * ((double)irL[i] * irL[i] + (double)irR[i] * irR[i]);
+    if (e <= 1e-12) { ESP_LOGE(TAG, "Silent impulse response"); return false; }
+    const float norm = (float)(1.0 / sqrt(e));
+
+    const int p = (len + CONV_BLOCK - 1) / CONV_BLOCK;
+    const size_t floats = (size_t)p * (4 + 2) * CONV_BINS;
+    mem = (float*)heap_caps_aligned_alloc(16, floats * sizeof(float), CONV_MALLOC_CAP);
+    if (!mem) {
+        ESP_LOGE(TAG, "No memory for %d partitions (%u bytes)", p, (unsigned)(floats * sizeof(float)));
+        return false;
+    }
+    filt = mem;
+    fdl  = mem + (size_t)p * 4 * CONV_BINS;
+
+    // Partition k: G = FFT of [hL + j·hR (CONV_BLOCK samples), zeros], stored per bin b ≤ N/2
+    // as G[b] and conj(G[N-b]) (upper half, 0 at b = 0 and N/2: those bins have no mirror)
+    for (int k = 0; k < p; ++k) {
+        memset(work, 0, sizeof(work));
+        const int base = k * CONV_BLOCK;
+        const int n = (len - base < CONV_BLOCK) ? len - base : CONV_BLOCK;
+        for (int i = 0; i < n; ++i) {
+            work[2 * i]     = irL[base + i] * norm;
+            work[2 * i + 1] = irR[base + i] * norm;
+        }
+        fft(work);
+        float* H = filt + (size_t)k * 4 * CONV_BINS;
+        for (int b = 0; b < CONV_BINS; ++b) {
+            const bool mirror = (b > 0 && b < CONV_FFT / 2);
+            H[4 * b]     = work[2 * b];
+            H[4 * b + 1] = work[2 * b + 1];
+            H[4 * b + 2] = mirror ?  work[2 * (CONV_FFT - b)]     : 0.0f;
+            H[4 * b + 3] = mirror ? -work[2 * (CONV_FFT - b) + 1] : 0.0f;
+        }
+    }
+    memset(fdl, 0, (size_t)p * 2 * CONV_BINS * sizeof(float));
+    memset(prevIn, 0, sizeof(prevIn));
+    fdlPos = 0;
+    parts  = p;
+    ready  = true;
+    ESP_LOGI(TAG, "IR: %d samples, %d partitions, %u bytes", len, p, (unsigned)(floats * sizeof(float)));
+    return true;
+}
+
+bool IRAM_ATTR FxConvolver::processBlock(float* signal_l, float* signal_r, float level) {
+    busy = true;
+    __sync_synchronize();
+    if (!ready) {                           // clear()/setImpulse() sürüyor: sinyale dokunma
+        busy = false;
+        return false;
+    }
+
+    // Overlap-save window: [previous block | this block], real → complex
+    for (int n = 0; n < CONV_BLOCK; ++n) {
+        const float x = 0.5f * (signal_l[n] + signal_r[n]);
+        work[2 * n]                    = prevIn[n];
+        work[2 * n + 1]                = 0.0f;
+        work[2 * (CONV_BLOCK + n)]     = x;
+        work[2 * (CONV_BLOCK + n) + 1] = 0.0f;
+        prevIn[n] = x;
+    }
+    fft(work);
+    memcpy(fdl + (size_t)fdlPos * 2 * CONV_BINS, work, sizeof(float) * 2 * CONV_BINS);
+
+    // Σ X(block - k) · G_k. X is real-input (upper half = mirrored conjugate), so each stored
+    // bin b feeds Y[b] += X[b]·G[b] and Y[N-b] = conj(Σ X[b]·conj(G[N-b])): X is read once
+    memset(acc, 0, sizeof(acc));
+    int slot = fdlPos;
+    for (int k = 0; k < parts; ++k) {
+        const float* X = fdl  + (size_t)slot * 2 * CONV_BINS;
+        const float* H = filt + (size_t)k * 4 * CONV_BINS;
+        float* a = acc;
+        for (int b = 0; b < CONV_BINS; ++b, X += 2, H += 4, a += 4) {
+            const float xr = X[0], xi = X[1];
+            a[0] += xr * H[0] - xi * H[1];
+            a[1] += xr * H[1] + xi * H[0];
+            a[2] += xr * H[2] - xi * H[3];
+            a[3] += xr * H[3] + xi * H[2];
+        }
+        slot = (slot == 0) ? parts - 1 : slot - 1;
+    }
+    fdlPos = (fdlPos + 1 == parts) ? 0 : fdlPos + 1;
+
+    // Inverse FFT as conj(FFT(conj(Y))) / N: left = real part, right = imaginary part
+    for (int b = 0; b < CONV_BINS; ++b) {
+        work[2 * b]     =  acc[4 * b];
+        work[2 * b + 1] = -acc[4 * b + 1];
+    }
+    for (int b = 1; b < CONV_FFT / 2; ++b) {       // conj(Y[N-b]) = Σ X[b]·conj(G[N-b])
+        work[2 * (CONV_FFT - b)]     = acc[4 * b + 2];
+        work[2 * (CONV_FFT - b) + 1] = acc[4 * b + 3];
+    }
+    fft(work);
+    const float g = level * (1.0f / CONV_FFT);
+    for (int n = 0; n < CONV_BLOCK; ++n) {
+        signal_l[n] =  work[2 * (CONV_BLOCK + n)]     * g;
+        signal_r[n] = -work[2 * (CONV_BLOCK + n) + 1] * g;
+    }
+    __sync_synchronize();
+    busy = false;
+    return true;
+}
+
+// ================================================================================================
+// WAV
+
+static inline uint32_t rd32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static inline uint16_t rd16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+bool FxConvolver::loadWav(const char* name) {
+    String path = String(CONV_IR_PATH);
+    if (name[0] == '/') path = ""; else path += '/';
+    path += name;
+
+    FsFile f;
+    if (!f.open(path.c_str(), O_RDONLY)) {
+        ESP_LOGE(TAG, "Can't open %s", path.c_str());
+        return false;
+    }
+
+    uint8_t hdr[16];
+    if (f.read(hdr, 12) != 12 || memcmp(hdr, "RIFF", 4) || memcmp(hdr + 8, "WAVE", 4)) {
+        f.close();
+        ESP_LOGE(TAG, "%s is not a WAV file", path.c_str());
+        return false;
+    }
+
+    // Chunks: fmt, then data (others skipped)
+    uint16_t format = 0, channels = 0, bits = 0;
+    uint32_t rate = 0, dataLen = 0;
+    bool haveFmt = false, haveData = false;
+    while (!haveData && f.read(hdr, 8) == 8) {
+        const uint32_t len = rd32(hdr + 4);
+        if (!memcmp(hdr, "fmt ", 4) && len >= 16) {
+            if (f.read(hdr, 16) != 16) break;
+            format   = rd16(hdr);
+            channels = rd16(hdr + 2);
+            rate     = rd32(hdr + 4);
+            bits     = rd16(hdr + 14);
+            if (format == 0xFFFE && len >= 26) {    // WAVE_FORMAT_EXTENSIBLE: subformat in the extension
+                uint8_t ext[10];
+                if (f.read(ext, 10) != 10) break;
+                format = rd16(ext + 8);
+                f.seekCur((int32_t)(len - 26 + (len & 1)));
+            } else {
+                f.seekCur((int32_t)(len - 16 + (len & 1)));
+            }
+            haveFmt = true;
+        } else if (!memcmp(hdr, "data", 4)) {
+            dataLen  = len;
+            haveData = true;
+        } else {
+            f.seekCur((int32_t)(len + (len & 1)));
+        }
+    }
+
+    const bool isFloat = (format == 3 && bits == 32);
+    const bool isPcm   = (format == 1 && (bits == 16 || bits == 24 || bits == 32));
+    if (!haveFmt || !haveData || channels == 0 || rate == 0 || !(isFloat || isPcm)) {
+        f.close();
+        ESP_LOGE(TAG, "%s: unsupported WAV (format %u, %u bit, %u ch)", path.c_str(), format, bits, channels);
+        return false;
+    }
+
+    const int frameBytes = channels * (bits / 8);
+    int frames = (int)(dataLen / frameBytes);
+    const int maxFrames = (int)((int64_t)CONV_IR_MAX_MS * rate / 1000) + 1;
+    if (frames > maxFrames) frames = maxFrames;
+    const bool stereo = (channels >= 2);
+
+    float* src = (float*)heap_caps_malloc(sizeof(float) * frames * (stereo ? 2 : 1), CONV_MALLOC_CAP);
+    if (!src) { f.close(); ESP_LOGE(TAG, "No memory for %d IR frames", frames); return false; }
+    float* srcR = stereo ? src + frames : nullptr;
+
+    // Parça parça oku, ilk iki kanalı float'a çevir
+    uint8_t chunk[512];
+    const int perChunk = (int)sizeof(chunk) / frameBytes;
+    int done = 0;
+    while (done < frames) {
+        const int want = (frames - done < perChunk) ? frames - done : perChunk;
+        const int got  = f.read(chunk, want * frameBytes) / frameBytes;
+        if (got <= 0) break;
+        for (int i = 0; i < got; ++i) {
+            const uint8_t* fr = chunk + i * frameBytes;
+            for (int c = 0; c < (stereo ? 2 : 1); ++c) {
+                const uint8_t* s = fr + c * (bits / 8);
+                float v;
+                if (isFloat)        { uint32_t u = rd32(s); memcpy(&v, &u, 4); }
+                else if (bits == 16) v = (int16_t)rd16(s) * (1.0f / 32768.0f);
+                else if (bits == 24) v = (int32_t)((uint32_t)(s[0] << 8 | s[1] << 16 | s[2] << 24)) * (1.0f / 2147483648.0f);
+                else                 v = (int32_t)rd32(s) * (1.0f / 2147483648.0f);
+                (c ? srcR : src)[done + i] = v;
+            }
+        }
+        done += got;
+    }
+    f.close();
+    if (done < 2) {
+        heap_caps_free(src);
+        ESP_LOGE(TAG, "%s: no sample data", path.c_str());
+        return false;
+    }
+
+    bool ok;
+    if (rate == SAMPLE_RATE) {
+        ok = setImpulse(src, srcR, done);
+    } else {
+        // Lineer yeniden örnekleme SAMPLE_RATE'e
+        const int outLen = (int)((int64_t)done * SAMPLE_RATE / rate);
+        float* dst = (float*)heap_caps_malloc(sizeof(float) * outLen * (stereo ? 2 : 1), CONV_MALLOC_CAP);
+        if (!dst || outLen < 1) {
+            if (dst) heap_caps_free(dst);
+            heap_caps_free(src);
+            ESP_LOGE(TAG, "No memory to resample the IR");
+            return false;
+        }
+        float* dstR = stereo ? dst + outLen : nullptr;
+        const float step = (float)rate / (float)SAMPLE_RATE;
+        for (int i = 0; i < outLen; ++i) {
+            const float pos = i * step;
+            int j = (int)pos;
+            if (j >= done - 1) j = done - 2;
+            const float fr = pos - j;
+            dst[i] = src[j] + fr * (src[j + 1] - src[j]);
+            if (stereo) dstR[i] = srcR[j] + fr * (srcR[j + 1] - srcR[j]);
+        }
+        ESP_LOGI(TAG, "IR resampled %u -> %d Hz", (unsigned)rate, SAMPLE_RATE);
+        ok = setImpulse(dst, dstR, outLen);
+        heap_caps_free(dst);
+    }
+    heap_caps_free(src);
+    if (ok) ESP_LOGI(TAG, "Loaded %s (%.0f ms)", path.c_str(), getLengthMs());
+    return ok;
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * ----------------------------------------------------------------------------
+ * ESP32-S3 SF2 Synthesizer Firmware
+ *
+ * Author: Evgeny Aslovskiy AKA Copych
+ * License: MIT
+ * Repository: https://github.com/copych/ESP32-S3_SF2_Sampler_Synthesizer
+ *
+ * File: fx_convolver.h
+ * Purpose: uniformly partitioned FFT convolution reverb (impulse response from SD)
+ *
+ *  Overlap-save, partition = DMA_BUFFER_LEN samples, FFT = 2 × partition.
+ *  The impulse response is cut into P partitions, each kept as the spectrum
+ *  of (left + j·right): one complex multiply-accumulate per bin then gives
+ *  both output channels, and a single inverse FFT returns left in the real
+ *  part and right in the imaginary part. The mono send spectra of the last P
+ *  blocks live in a frequency-domain delay line (FDL, half spectrum: the send
+ *  is real). Per block: 2 FFTs + P × CONV_FFT complex MACs, filter and FDL
+ *  streamed from PSRAM (each FDL bin is read once and feeds both the bin and
+ *  its mirror, whose filter value is stored next to it).
+ *  FFT: esp-dsp (dsps_fft2r_fc32) on target, a portable radix-2 elsewhere.
+ *
+ *  Cost per IR length (partition 128, FFT 256, 44.1 kHz). Memory and PSRAM
+ *  traffic are exact; host time is an x86 build.
+ *
+ *    IR length | partitions | PSRAM   | PSRAM read / s | host µs / block | S3 estimate / block
+ *    ----------+------------+---------+----------------+-----------------+--------------------
+ *      50 ms   |     18     |   54 KB |     19 MB/s    |      24         |  ~200 k cyc (29 %)
+ *     100 ms   |     35     |  106 KB |     37 MB/s    |      35         |  ~355 k cyc (51 %)
+ *     250 ms   |     87     |  263 KB |     93 MB/s    |      60         |  ~840 k cyc (> block)
+ *     500 ms   |    173     |  523 KB |    185 MB/s    |     113         | ~1640 k cyc (> block)
+ *    1000 ms   |    345     | 1043 KB |    368 MB/s    |     208         | ~3240 k cyc (> block)
+ *
+ *  The S3 column is an ESTIMATE, not a measurement: it assumes the MAC loop
+ *  is bound by PSRAM at ~80 MB/s effective read (3096 bytes per partition ≈
+ *  9.3 k cycles at 240 MHz) plus ~30 k cycles for the two esp-dsp FFTs and
+ *  the window/output loops; a block is 128 / 44100 s = ~697 k cycles. So on
+ *  target only IRs of roughly 100-150 ms fit next to the voices, and the
+ *  PSRAM read rate is shared with sample playback. To measure: build with
+ *  TASK_BENCHMARKING, ENABLE_REVERB and ENABLE_CONV_REVERB, load an IR and
+ *  read the "Reverb: N cycles per block" log (reverbCycles wraps the
+ *  convolver call). CONV_IR_MAX_MS truncates longer files.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+#ifdef ENABLE_CONV_REVERB
+
+constexpr int DRAM_ATTR CONV_BLOCK = DMA_BUFFER_LEN;      // partition length
+constexpr int DRAM_ATTR CONV_FFT   = 2 * CONV_BLOCK;      // overlap-save FFT size
+constexpr int DRAM_ATTR CONV_BINS  = CONV_FFT / 2 + 1;    // stored bins of a real send spectrum
+
+class FxConvolver {
+public:
+    // WAV (PCM 16/24/32-bit or float, mono or stereo) from SD; relative names under CONV_IR_PATH.
+    // Other sample rates are resampled linearly to SAMPLE_RATE.
+    bool loadWav(const char* name);
+
+    // Impulse response at SAMPLE_RATE, irR = nullptr for mono. Normalised to 0 dB noise gain.
+    // The engine is bypassed (isReady() = false) while the partitions are rebuilt.
+    // Control side only: clear() waits until a running processBlock() has returned.
+    bool setImpulse(const float* irL, const float* irR, int len);
+
+    void clear();
+
+    inline bool  isReady() const        { return ready; }
+    inline int   getPartitions() const  { return parts; }
+    inline float getLengthMs() const    { return parts * CONV_BLOCK * 1000.0f / SAMPLE_RATE; }
+
+    // Reverb send in, wet out (in place), once per block. false = no IR (being rebuilt),
+    // the buffers are untouched and the caller renders its fallback reverb.
+    bool processBlock(float* signal_l, float* signal_r, float level);
+
+private:
+    static bool initFft();
+    static void fft(float* data);           // in-place forward complex FFT, CONV_FFT points, re/im interleaved
+
+    float* mem  = nullptr;                  // one allocation: filter partitions | FDL
+    float* filt = nullptr;                  // parts × CONV_BINS × {G[b], conj(G[N-b])}, G = FFT(hL_p + j·hR_p)
+    float* fdl  = nullptr;                  // parts × CONV_BINS complex, ring of send spectra
+    int    parts  = 0;
+    int    fdlPos = 0;
+    volatile bool ready = false;
+    volatile bool busy  = false;            // set by processBlock() for the whole block, clear() waits on it
+
+    alignas(16) float work[2 * CONV_FFT];
+    alignas(16) float acc[4 * CONV_BINS];   // per stored bin: Y[b], conj(Y[N-b])
+    float prevIn[CONV_BLOCK] = {};          // previous send block (overlap-save window)
+};
+
+#endif
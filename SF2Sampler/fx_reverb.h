@@ -1,10 +1,23 @@
 /*
 * FxReverb - Reverberation audio effect
-* based on a freeverb conception
+* 8-line feedback delay network (FDN)
 * stereo processing of a mono input signal
 * has a pre-delay setting 0..MAX_PREDELAY_MS
-* has damping setting 0..1
-* 
+* has damping setting 0..1 (in-loop lowpass, higher = brighter tail, as the comb version)
+*
+* All delay lines share one power-of-two buffer: each sample frame holds the
+* REV_LINES line values side by side, one write index and one mask serve all
+* of them (no modulo, no per-line wrap compare). The pre-delay is a second
+* masked ring in the same allocation. The lines are mixed through an 8x8
+* Hadamard matrix (lossless), each line's gain sets the decay time.
+* State is kept in locals for a whole block.
+*
+* REVERB_HALF_RATE: the send is decimated by 2 with a 19-tap half-band FIR,
+* the tank runs at SAMPLE_RATE / 2 and its output is interpolated back with
+* the same half-band (polyphase: the even output phase is a plain delay, the
+* odd one a 5-coefficient symmetric sum). Half the tank work and memory;
+* the tail is band-limited to ~10 kHz, which the damping mostly removes anyway.
+*
 * May 2025
 * Author: Evgeny Aslovskiy AKA Copych
 * License: MIT
@@ -12,68 +25,64 @@
 
 #pragma once
 #include "config.h"
+#include "misc.h"
 
-#ifdef BOARD_HAS_PSRAM 
-  #define REV_MULTIPLIER 1.8f
-  #define MALLOC_CAP MALLOC_CAP_SPIRAM
+#ifdef BOARD_HAS_PSRAM
+  #define REV_SCALE 1.0f
+  #define REV_MALLOC_CAP MALLOC_CAP_SPIRAM
 #else
-  #define REV_MULTIPLIER 0.35f
-  #define MALLOC_CAP MALLOC_CAP_INTERNAL
+  #define REV_SCALE 0.35f
+  #define REV_MALLOC_CAP MALLOC_CAP_INTERNAL
 #endif
 
-constexpr int DRAM_ATTR NUM_COMBS = 4;
-constexpr int DRAM_ATTR NUM_ALLPASSES = 3;
-constexpr int DRAM_ATTR MAX_PREDELAY_MS = 100;
-
-const DRAM_ATTR float comb_lengths[NUM_COMBS] = {3604.0f, 3112.0f, 4044.0f, 4492.0f};
-const DRAM_ATTR float comb_gains[NUM_COMBS]   = {0.805f, 0.827f, 0.783f, 0.764f};
-const DRAM_ATTR float comb_damping_coef[NUM_COMBS] = {0.83f, 0.9f, 1.0f, 0.8f}; 
+#ifdef REVERB_HALF_RATE
+  #define REV_RATE_DIV 2
+#else
+  #define REV_RATE_DIV 1
+#endif
 
-const DRAM_ATTR float allpass_lengths[NUM_ALLPASSES] = {500.0f, 168.0f, 48.0f};
-const DRAM_ATTR float allpass_gains[NUM_ALLPASSES]   = {0.707f, 0.707f, 0.707f};
+constexpr int DRAM_ATTR REV_LINES = 8;
+constexpr int DRAM_ATTR MAX_PREDELAY_MS = 100;
+constexpr float DRAM_ATTR REV_TANK_RATE = float(SAMPLE_RATE) / REV_RATE_DIV;
+constexpr int DRAM_ATTR REV_TANK_BLOCK = DMA_BUFFER_LEN / REV_RATE_DIV;
+
+// Mutually prime line lengths (samples at 44.1 kHz, REV_SCALE 1), ~32..65 ms
+const DRAM_ATTR float fdn_lengths[REV_LINES] = {1433.0f, 1601.0f, 1867.0f, 2053.0f, 2251.0f, 2399.0f, 2617.0f, 2867.0f};
+
+#ifdef REVERB_HALF_RATE
+// Half-band (Kaiser, beta 6): centre tap 0.5, taps at odd offsets ±1..±9, even offsets 0.
+// -3 dB at 10 kHz, -25 dB at 14 kHz, < -66 dB from 16 kHz
+constexpr int DRAM_ATTR HB_PAIRS = 5;
+constexpr int DRAM_ATTR HB_TAPS  = 4 * HB_PAIRS - 1;
+const DRAM_ATTR float hb_coefs[HB_PAIRS] = {0.307912316f, -0.077708945f, 0.025554743f, -0.006284507f, 0.000526392f};
+#endif
 
 class FxReverb {
 public:
   FxReverb() {}
 
   inline void init() {
-    for (int ch = 0; ch < 2; ++ch) {
-      for (int i = 0; i < NUM_COMBS; ++i) {
-        int size = int((comb_lengths[i] + ch * 17) * REV_MULTIPLIER); // small offset for stereo
-        combBuf[ch][i] = (float*)heap_caps_aligned_alloc(4, sizeof(float) * size, MALLOC_CAP);
-        combSize[ch][i] = size;
-        combPtr[ch][i] = 0;
-        combStore[ch][i] = 0.0f;
-
-        if (!combBuf[ch][i]) {
-          ESP_LOGE("Reverb", "No memory for combBuf[%d][%d]", ch, i);
-        } else {
-          memset(combBuf[ch][i], 0, sizeof(float) * size);
-        }
-      }
-
-      for (int i = 0; i < NUM_ALLPASSES; ++i) {
-        int size = int((allpass_lengths[i] + ch * 11) * REV_MULTIPLIER); // offset for stereo
-        allpassBuf[ch][i] = (float*)heap_caps_aligned_alloc(4, sizeof(float) * size, MALLOC_CAP);
-        allpassSize[ch][i] = size;
-        allpassPtr[ch][i] = 0;
-
-        if (!allpassBuf[ch][i]) {
-          ESP_LOGE("Reverb", "No memory for allpassBuf[%d][%d]", ch, i);
-        } else {
-          memset(allpassBuf[ch][i], 0, sizeof(float) * size);
-        }
-      }
+    int maxLen = 0;
+    for (int k = 0; k < REV_LINES; ++k) {
+      lineLen[k] = int(fdn_lengths[k] * REV_SCALE / REV_RATE_DIV);
+      if (lineLen[k] > maxLen) maxLen = lineLen[k];
     }
-    int size = int((MAX_PREDELAY_MS / 1000.0f) * SAMPLE_RATE);
-    predelayBuf = (float*)heap_caps_aligned_alloc(4, sizeof(float) * size, MALLOC_CAP);
-    if (!predelayBuf) {
-      ESP_LOGE("Reverb", "Failed to allocate predelayBuf");
-    } else {
-      memset(predelayBuf, 0, sizeof(float) * size);
-      predelaySize = size;
-      predelayPtr = 0;
+    const int tankLen = nextPow2(maxLen + 1);
+    const int preLen  = nextPow2(int((MAX_PREDELAY_MS / 1000.0f) * REV_TANK_RATE) + 1);
+    const size_t bytes = sizeof(float) * (size_t(tankLen) * REV_LINES + preLen);
+
+    buf = (float*)heap_caps_aligned_alloc(16, bytes, REV_MALLOC_CAP);
+    if (!buf) {
+      ESP_LOGE("Reverb", "No memory for FDN buffer (%u bytes)", (unsigned)bytes);
+      return;
     }
+    memset(buf, 0, bytes);
+    tank      = buf;
+    tankMask  = tankLen - 1;
+    predelay  = buf + size_t(tankLen) * REV_LINES;
+    preMask   = preLen - 1;
+    ESP_LOGI("Reverb", "FDN: %d lines at %.0f Hz, %u bytes", REV_LINES, REV_TANK_RATE, (unsigned)bytes);
+
     setLevel(1.0f);
     setTime(0.8f);
     setPreDelayTime(10.0f);
@@ -83,137 +92,176 @@ public:
   inline float getTimeRaw() const {  return (rev_time - 0.02f)/0.97f;  }
   inline float getTime() const {  return rev_time;  }
   inline float getLevel() const { return rev_level; }
-  inline float getPreDelayTime() const { return float(delaySamples * 1000.0f * DIV_SAMPLE_RATE); }
+  inline float getPreDelayTime() const { return float(delaySamples * 1000.0f / REV_TANK_RATE); }
   inline float getDamping() const { return globalDamping; }
-  
+
 
   inline void setPreDelayTime(float ms) {
-    delaySamples = int(ms * 0.001f * SAMPLE_RATE);
-    if (delaySamples >= predelaySize) delaySamples = predelaySize - 1;
+    delaySamples = int(ms * 0.001f * REV_TANK_RATE);
+    if (delaySamples > preMask) delaySamples = preMask;
     if (delaySamples < 0) delaySamples = 0;
-    predelayReadOffset = (predelayPtr - delaySamples + predelaySize) % predelaySize;
 
     ESP_LOGD("Reverb", "Pre-delay set to %.1f ms (%d samples)", ms, delaySamples);
   }
 
+  // value 0..1 → decay (T60) 0.3 .. 5 s; each line loses -60 dB over T60
   inline void setTime(float value) {
     rev_time = 0.97f * value + 0.02f;
-    for (int ch = 0; ch < 2; ++ch) {
-      for (int i = 0; i < NUM_COMBS; ++i)
-        combLim[ch][i] = int(rev_time * combSize[ch][i]);
-      for (int i = 0; i < NUM_ALLPASSES; ++i)
-        allpassLim[ch][i] = int(rev_time * allpassSize[ch][i]);
+    const float t60 = 0.2f + 4.8f * rev_time;
+    for (int k = 0; k < REV_LINES; ++k) {
+      // 10^(-3·len/(T60·fs)), Hadamard normalisation 1/sqrt(8) folded in
+      lineGain[k] = exp2f(-9.965784f * float(lineLen[k]) / (t60 * REV_TANK_RATE)) * 0.35355339f;
     }
   }
 
   inline void setLevel(float value) {     rev_level = value;   }
-  
+
   inline void setDamping(float d) {
     globalDamping = d < 0.0f ? 0.0f : (d > 1.0f ? 1.0f : d);
-    for (int i = 0; i < NUM_COMBS; ++i) {
-      comb_dampings[i] = globalDamping * comb_damping_coef[i] ;
-    }
+    // Saklı presetler aynı tınıda kalsın: eski comb filtresindeki gibi 1 = açık, 0 = en koyu
+    float pole = 0.85f * (1.0f - globalDamping); // one-pole: 0 = open, 0.85 ≈ 1 kHz
+#ifdef REVERB_HALF_RATE
+    pole *= pole;                               // same cutoff at half the rate
+#endif
+    dampCoef = 1.0f - pole;
     ESP_LOGI("Reverb", "Global damping set to %.2f", globalDamping);
   }
-  
-  inline void  __attribute__((hot,always_inline)) IRAM_ATTR processBlock(float* signal_l, float* signal_r) {
-    for (int n = 0; n < DMA_BUFFER_LEN; ++n) {
-      float inSample = 0.5f * (signal_l[n] + signal_r[n]);
 
-      // Pre-delay
-      predelayBuf[predelayPtr] = inSample;
-      float delayed = predelayBuf[predelayReadOffset];
-      predelayPtr = (predelayPtr + 1) % predelaySize;
-      predelayReadOffset = (predelayReadOffset + 1) % predelaySize;
+  inline void  __attribute__((hot,always_inline)) IRAM_ATTR processBlock(float* signal_l, float* signal_r) {
+#ifdef REVERB_HALF_RATE
+    // Mono send after the decimator history, then 2:1 down, tank, 1:2 up
+    float* x = decHist + HB_TAPS - 1;
+    for (int n = 0; n < DMA_BUFFER_LEN; ++n) x[n] = 0.5f * (signal_l[n] + signal_r[n]);
+
+    float in[REV_TANK_BLOCK], wetL[REV_TANK_BLOCK], wetR[REV_TANK_BLOCK];
+    const float h0 = hb_coefs[0], h1 = hb_coefs[1], h2 = hb_coefs[2], h3 = hb_coefs[3], h4 = hb_coefs[4];
+    for (int m = 0; m < REV_TANK_BLOCK; ++m) {
+      const float* c = decHist + 2 * m + 2 * HB_PAIRS - 1;   // centre tap
+      in[m] = 0.5f * c[0] + h0 * (c[-1] + c[1]) + h1 * (c[-3] + c[3]) + h2 * (c[-5] + c[5])
+                          + h3 * (c[-7] + c[7]) + h4 * (c[-9] + c[9]);
+    }
+    memmove(decHist, decHist + DMA_BUFFER_LEN, sizeof(float) * (HB_TAPS - 1));
 
-      float wetL = processChannel(0, delayed);
-      float wetR = processChannel(1, delayed);
+    run(in, wetL, wetR, REV_TANK_BLOCK);
 
-      signal_l[n] = rev_level * wetL;
-      signal_r[n] = rev_level * wetR;
-    }
+    interpolate(upHistL, wetL, signal_l);
+    interpolate(upHistR, wetR, signal_r);
+#else
+    float in[DMA_BUFFER_LEN];
+    for (int n = 0; n < DMA_BUFFER_LEN; ++n) in[n] = 0.5f * (signal_l[n] + signal_r[n]);
+    run(in, signal_l, signal_r, DMA_BUFFER_LEN);
+#endif
   }
 
+#ifndef REVERB_HALF_RATE
   inline void  __attribute__((hot,always_inline)) IRAM_ATTR process(float* signal_l, float* signal_r) {
-    // Store current input sample into predelay buffer
-    float inSample = 0.5f * (*signal_l + *signal_r);
-    predelayBuf[predelayPtr] = inSample;
-
-    // Read from pre-delay buffer
-    float delayedSample = predelayBuf[predelayReadOffset];
-
-    // Advance pointers
-    predelayPtr = (predelayPtr + 1) % predelaySize;
-    predelayReadOffset = (predelayReadOffset + 1) % predelaySize;
-
-    // Use delayedSample for reverb input
-    float wetL = processChannel(0, delayedSample);
-    float wetR = processChannel(1, delayedSample);
-
-
-    *signal_l = rev_level * wetL;
-    *signal_r = rev_level * wetR;
+    const float in = 0.5f * (*signal_l + *signal_r);
+    run(&in, signal_l, signal_r, 1);
   }
+#endif
 
 private:
 
-  float comb_dampings[NUM_COMBS] = {0.2f, 0.25f, 0.3f, 0.22f}; 
-  float* predelayBuf = nullptr;
-  int predelaySize = 0;
-  int predelayPtr = 0;
+  float* buf = nullptr;         // tank | pre-delay, one allocation
+  float* tank = nullptr;        // frame i = REV_LINES floats at tank[i * REV_LINES]
+  float* predelay = nullptr;
+  int tankMask = 0;
+  int preMask = 0;
+  int writePos = 0;
+  int preWritePos = 0;
   int delaySamples = 0;
-  int predelayReadOffset = 0;
+
+  int   lineLen[REV_LINES] = {};
+  float lineGain[REV_LINES] = {};
+  float lineLp[REV_LINES] = {};  // in-loop damping state
+  float dampCoef = 1.0f;
   float globalDamping = 0.25f;
 
   float rev_time = 0.5f;
   float rev_level = 0.5f;
 
-  float* combBuf[2][NUM_COMBS] = {};
-  int combSize[2][NUM_COMBS] = {};
-  int combPtr[2][NUM_COMBS] = {};
-  int combLim[2][NUM_COMBS] = {};
-  float combStore[2][NUM_COMBS] = {};  // for damping
-
-  float* allpassBuf[2][NUM_ALLPASSES] = {};
-  int allpassSize[2][NUM_ALLPASSES] = {};
-  int allpassPtr[2][NUM_ALLPASSES] = {};
-  int allpassLim[2][NUM_ALLPASSES] = {};
-
-  inline float  __attribute__((hot,always_inline)) IRAM_ATTR processChannel(int ch, float input) {
-    float sum = 0.0f;
-    for (int i = 0; i < NUM_COMBS; ++i)
-      sum += doComb(ch, i, input);
-    float out = sum / NUM_COMBS;
-    for (int i = 0; i < NUM_ALLPASSES; ++i)
-      out = doAllpass(ch, i, out);
-    return out;
+#ifdef REVERB_HALF_RATE
+  float decHist[HB_TAPS - 1 + DMA_BUFFER_LEN] = {};     // full-rate send, last HB_TAPS-1 kept
+  float upHistL[2 * HB_PAIRS + REV_TANK_BLOCK] = {};    // half-rate tank output, last 2*HB_PAIRS kept
+  float upHistR[2 * HB_PAIRS + REV_TANK_BLOCK] = {};
+
+  // 1:2 polyphase half-band: even phase = centre tap (delay HB_PAIRS), odd phase = symmetric sum
+  inline void __attribute__((always_inline)) IRAM_ATTR interpolate(float* hist, const float* u, float* out) {
+    memcpy(hist + 2 * HB_PAIRS, u, sizeof(float) * REV_TANK_BLOCK);
+    const float h0 = 2.0f * hb_coefs[0], h1 = 2.0f * hb_coefs[1], h2 = 2.0f * hb_coefs[2];
+    const float h3 = 2.0f * hb_coefs[3], h4 = 2.0f * hb_coefs[4];
+    for (int m = 0; m < REV_TANK_BLOCK; ++m) {
+      const float* c = hist + m + HB_PAIRS;         // u[m - HB_PAIRS]
+      out[2 * m]     = c[0];
+      out[2 * m + 1] = h0 * (c[0] + c[1]) + h1 * (c[-1] + c[2]) + h2 * (c[-2] + c[3])
+                     + h3 * (c[-3] + c[4]) + h4 * (c[-4] + c[5]);
+    }
+    memmove(hist, hist + REV_TANK_BLOCK, sizeof(float) * 2 * HB_PAIRS);
   }
+#endif
 
-  inline float  __attribute__((hot,always_inline)) IRAM_ATTR doComb(int ch, int idx, float in) {
-    int& p = combPtr[ch][idx];
-    float g = comb_gains[idx];
-    float& store = combStore[ch][idx];
-    float* buf = combBuf[ch][idx];
-
-    float out = buf[p];
- //   store += comb_dampings[idx] * (out - store);  // 1-pole LPF
-    store = store * (1.0f - comb_dampings[idx]) + out * comb_dampings[idx];
-
-    buf[p] = in + store * g;
-    p = (p + 1 >= combLim[ch][idx]) ? 0 : p + 1;
-    return out;
+  static inline int nextPow2(int v) {
+    int p = 1;
+    while (p < v) p <<= 1;
+    return p;
   }
 
+  // Tank at REV_TANK_RATE: mono send in, stereo wet out
+  inline void  __attribute__((hot,always_inline)) IRAM_ATTR run(const float* send, float* signal_l, float* signal_r, int count) {
+    if (!buf) {
+      memset(signal_l, 0, sizeof(float) * count);
+      memset(signal_r, 0, sizeof(float) * count);
+      return;
+    }
+    // Blok boyunca durum yerel değişkenlerde
+    float* const t    = tank;
+    float* const pre  = predelay;
+    const int    mask = tankMask;
+    const int    pmsk = preMask;
+    const int    pd   = delaySamples;
+    const float  a    = dampCoef;
+    const float  out  = rev_level * 1.1f;     // noise send ≈ the old comb/allpass output level
+    int w  = writePos;
+    int pw = preWritePos;
+    float lp[REV_LINES], g[REV_LINES];
+    int   len[REV_LINES];
+    for (int k = 0; k < REV_LINES; ++k) { lp[k] = lineLp[k]; g[k] = lineGain[k]; len[k] = lineLen[k]; }
+
+    for (int n = 0; n < count; ++n) {
+      // Pre-delay
+      pre[pw] = send[n];
+      const float in = pre[(pw - pd) & pmsk];
+      pw = (pw + 1) & pmsk;
+
+      // Line outputs through the damping lowpass
+      for (int k = 0; k < REV_LINES; ++k) {
+        const float x = t[((w - len[k]) & mask) * REV_LINES + k];
+        lp[k] += a * (x - lp[k]);
+      }
+
+      signal_l[n] = out * (lp[0] + lp[2] + lp[4] + lp[6]);
+      signal_r[n] = out * (lp[1] + lp[3] + lp[5] + lp[7]);
+
+      // 8x8 Hadamard (fast Walsh-Hadamard: 3 add/sub stages)
+      const float a0 = lp[0] + lp[1], a1 = lp[0] - lp[1], a2 = lp[2] + lp[3], a3 = lp[2] - lp[3];
+      const float a4 = lp[4] + lp[5], a5 = lp[4] - lp[5], a6 = lp[6] + lp[7], a7 = lp[6] - lp[7];
+      const float b0 = a0 + a2, b1 = a1 + a3, b2 = a0 - a2, b3 = a1 - a3;
+      const float b4 = a4 + a6, b5 = a5 + a7, b6 = a4 - a6, b7 = a5 - a7;
+
+      float* f = t + w * REV_LINES;
+      f[0] = (b0 + b4) * g[0] + in;
+      f[1] = (b1 + b5) * g[1] + in;
+      f[2] = (b2 + b6) * g[2] + in;
+      f[3] = (b3 + b7) * g[3] + in;
+      f[4] = (b0 - b4) * g[4] + in;
+      f[5] = (b1 - b5) * g[5] + in;
+      f[6] = (b2 - b6) * g[6] + in;
+      f[7] = (b3 - b7) * g[7] + in;
+      w = (w + 1) & mask;
+    }
 
-  inline float  __attribute__((hot,always_inline)) IRAM_ATTR doAllpass(int ch, int idx, float in) {
-    int& p = allpassPtr[ch][idx];
-    float g = allpass_gains[idx];
-    float* buf = allpassBuf[ch][idx];
-    float out = buf[p];
-    float v = out * g + in;
-    buf[p] = v;
-    out = out - g * in;
-    p = (p + 1 >= allpassLim[ch][idx]) ? 0 : p + 1;
-    return out;
+    writePos    = w;
+    preWritePos = pw;
+    for (int k = 0; k < REV_LINES; ++k) lineLp[k] = lp[k];
   }
 };
@@ -0,0 +1,68 @@
+/*
+ * ----------------------------------------------------------------------------
+ * ESP32-S3 SF2 Synthesizer Firmware
+ *
+ * Author: Evgeny Aslovskiy AKA Copych
+ * License: MIT
+ * Repository: https://github.com/copych/ESP32-S3_SF2_Sampler_Synthesizer
+ *
+ * File: governor.h
+ * Purpose: adaptive polyphony governor
+ *
+ *  Fed with the measured render cycles of every block, compared against the
+ *  block deadline (DMA_BUFFER_LEN / SAMPLE_RATE at GOV_CPU_MHZ). When the
+ *  smoothed load climbs over GOV_HIGH_LOAD it first switches the voices to
+ *  draft (non-interpolated) playback, then lowers the effective voice cap one
+ *  step at a time; the synth retires voices above the cap. Under GOV_LOW_LOAD
+ *  the steps are undone in reverse order. GOV_HOLD_BLOCKS between steps lets
+ *  each one take effect before the next decision.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+class PolyGovernor {
+public:
+    static constexpr float BudgetCycles = (float)GOV_CPU_MHZ * 1.0e6f * (float)DMA_BUFFER_LEN / (float)SAMPLE_RATE;
+
+    // Audio thread, once per block
+    inline void update(uint32_t renderCycles) {
+        const float load = (float)renderCycles * (1.0f / BudgetCycles);
+        avgLoad += 0.125f * (load - avgLoad);
+        if (load >= 1.0f) overruns++;
+
+        if (hold > 0) { hold--; return; }
+
+        if (avgLoad > GOV_HIGH_LOAD || load >= 1.0f) {
+            if (!draft) {
+                draft = true;
+                hold  = GOV_HOLD_BLOCKS;
+            } else if (cap > GOV_MIN_VOICES) {
+                cap--;
+                hold = GOV_HOLD_BLOCKS;
+            }
+        } else if (avgLoad < GOV_LOW_LOAD) {
+            if (cap < MAX_VOICES) {
+                cap++;
+                hold = GOV_HOLD_BLOCKS;
+            } else if (draft) {
+                draft = false;
+                hold  = GOV_HOLD_BLOCKS;
+            }
+        }
+    }
+
+    inline int   voiceCap()  const { return cap; }
+    inline bool  isDraft()   const { return draft; }
+    inline float load()      const { return avgLoad; }
+    inline uint32_t getOverruns() const { return overruns; }
+
+private:
+    volatile int   cap      = MAX_VOICES;
+    volatile bool  draft    = false;
+    float          avgLoad  = 0.0f;
+    uint32_t       hold     = 0;
+    uint32_t       overruns = 0;    // blocks that took longer than the deadline
+};
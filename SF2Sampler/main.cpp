@@ -86,17 +86,36 @@ static StackType_t  control_stack[8192/sizeof(StackType_t)] DRAM_ATTR;
 #ifdef ENABLE_GUI
 static StackType_t  gui_stack[5000/sizeof(StackType_t)]    DRAM_ATTR;
 #endif
+#ifdef ENABLE_FX_PIPELINE
+TaskHandle_t TaskFx;
+static StaticTask_t fx_tcb;
+static StackType_t  fx_stack[6144/sizeof(StackType_t)] DRAM_ATTR;
+#endif
+#ifdef ENABLE_DUAL_CORE_RENDER
+TaskHandle_t TaskRenderHelper;
+static StaticTask_t render_helper_tcb;
+static StackType_t  render_helper_stack[6144/sizeof(StackType_t)] DRAM_ATTR;
+#endif
 
 int Voice::usage; // counts voices internally
 
 
 // ========================== MIDI Instance ===============================================================================================
+#ifdef ENABLE_MICROTUNING
+    // MTS bulk tuning dump is 408 bytes, the library's default SysEx buffer 128
+    struct SynthMidiSettings : public MIDI_NAMESPACE::DefaultSettings {
+        static const unsigned SysExMaxSize = 512;
+    };
+#else
+    using SynthMidiSettings = MIDI_NAMESPACE::DefaultSettings;
+#endif
+
 #if MIDI_IN_DEV == USE_MIDI_STANDARD
-    MIDI_CREATE_INSTANCE(HardwareSerial, Serial1, MIDI);
+    MIDI_CREATE_CUSTOM_INSTANCE(HardwareSerial, Serial1, MIDI, SynthMidiSettings);
 #endif
 
 #if MIDI_IN_DEV == USE_USB_MIDI_DEVICE
-    USBMIDI_CREATE_INSTANCE(0, MIDI); 
+    USBMIDI_CREATE_CUSTOM_INSTANCE(0, MIDI, SynthMidiSettings); 
 #endif
 
 // ========================== Global devices ===============================================================================================
@@ -110,6 +129,11 @@ int Voice::usage; // counts voices internally
     FxReverb    DRAM_ATTR   reverb;
 #endif
 
+#ifdef ENABLE_CONV_REVERB
+    #include "fx_convolver.h"
+    FxConvolver DRAM_ATTR   convolver;
+#endif
+
 #ifdef ENABLE_DELAY
     #include "fx_delay.h"
     FxDelay     DRAM_ATTR   delayfx;
@@ -187,6 +211,14 @@ void handleSystemExclusive( uint8_t* data, size_t len) {
     uint32_t DRAM_ATTR dt1,dt2,dt3,dt4,dt5,dt6;
     uint32_t DRAM_ATTR total_render = 0;
     uint32_t DRAM_ATTR total_write  = 0;
+    uint32_t DRAM_ATTR total_voice_ctl = 0;   // Voice::updateModulators() cycles (mod env/LFO + filter)
+    uint32_t DRAM_ATTR count_voice_ctl = 0;   // voice-blocks measured
+    uint32_t DRAM_ATTR total_ghost_cycles = 0; // ghost (stolen voice fade-out) rendering cycles
+    uint32_t DRAM_ATTR total_voice_mix = 0;    // per voice-block sample loop (incl. prefetch) cycles
+    uint32_t DRAM_ATTR count_voice_mix = 0;
+    uint32_t DRAM_ATTR total_voice_mix_hi = 0; // same, voices with phase increment >= 2
+    uint32_t DRAM_ATTR count_voice_mix_hi = 0;
+    uint32_t DRAM_ATTR count_voice_filter_off = 0; // voice-blocks rendered with the voice filter bypassed
 #endif
 
     volatile uint32_t DRAM_ATTR frame_count  = 0;
@@ -234,7 +266,7 @@ static void IRAM_ATTR control_task(void *userData) {
     for (;;) {
         for (int k = 0; k < 64 && MIDI.read(); ++k) { /* drain MIDI */ }
         // MIDI.read();
-        synth.updateScores();
+        synth.updateVoiceControls();
 
 #ifdef ENABLE_GUI
         if (__builtin_expect((gui_blocker == 0), 1)) {
@@ -258,9 +290,71 @@ static void IRAM_ATTR control_task(void *userData) {
 
             ESP_LOGI(TAG, "Avg cycles over %u frames: render = %u, write = %u",
                      frame_count, avg_render, avg_write);
+#ifdef ENABLE_VOICE_RETIRE
+            ESP_LOGI(TAG, "Voices retired below %.0f dBFS: %u", (float)VOICE_RETIRE_DBFS, synth.retiredVoices);
+#endif
+            ESP_LOGI(TAG, "Ghost slots: %u steals faded, %u hard cuts, %u cycles per block",
+                     synth.ghostUses, synth.ghostMisses, total_ghost_cycles / frame_count);
+            if (count_voice_ctl) {
+                ESP_LOGI(TAG, "Voice control: %u cycles per voice-block (%u voice-blocks)",
+                         total_voice_ctl / count_voice_ctl, count_voice_ctl);
+            }
+            if (count_voice_mix) {
+                ESP_LOGI(TAG, "Voice sample loop: %u cycles per voice-block, high-pitched (inc >= 2): %u (%u voice-blocks)",
+                         total_voice_mix / count_voice_mix,
+                         count_voice_mix_hi ? total_voice_mix_hi / count_voice_mix_hi : 0, count_voice_mix_hi);
+            }
+#ifdef ENABLE_IN_VOICE_FILTERS
+            ESP_LOGI(TAG, "Voice filter bypassed in %u of %u voice-blocks", count_voice_filter_off, count_voice_mix);
+#endif
+#ifdef ENABLE_SAMPLE_PREFETCH
+            {
+                uint32_t fallbacks = 0;
+                for (uint32_t& n : synth.prefetchFallbacks) { fallbacks += n; n = 0; }
+                ESP_LOGI(TAG, "Prefetch: %u voice-blocks read PSRAM directly (span > %d)", fallbacks, VOICE_PREFETCH_LEN);
+            }
+#endif
+#ifdef ENABLE_HOT_SAMPLES
+            {
+                uint32_t hot = 0;
+                for (uint32_t& n : synth.hotBlocks) { hot += n; n = 0; }
+                ESP_LOGI(TAG, "Hot samples: %u voice-blocks from internal RAM (%u bytes), %u voice-blocks total",
+                         hot, (unsigned)synth.parser.getHotBytes(), count_voice_mix);
+            }
+#endif
+#ifdef ENABLE_DUAL_CORE_RENDER
+            ESP_LOGI(TAG, "Voice mixing per block: core1 = %u, core0 = %u cycles",
+                     synth.coreRenderCycles[1] / frame_count, synth.coreRenderCycles[0] / frame_count);
+            synth.coreRenderCycles[0] = 0;
+            synth.coreRenderCycles[1] = 0;
+#endif
+#ifdef ENABLE_POLY_GOVERNOR
+            {
+                const PolyGovernor& gov = synth.getGovernor();
+                ESP_LOGI(TAG, "Governor: load %.2f, voice cap %d, draft %d, overruns %u, retired %u",
+                         gov.load(), gov.voiceCap(), gov.isDraft(), gov.getOverruns(), synth.governorRetired);
+            }
+#endif
+#ifdef ENABLE_REVERB
+            ESP_LOGI(TAG, "Reverb: %u cycles per block", synth.reverbCycles / frame_count);
+            synth.reverbCycles = 0;
+#endif
+#ifdef ENABLE_FX_PIPELINE
+            ESP_LOGI(TAG, "Effects + master on core0: %u cycles per block, %u late blocks", synth.fxCycles / frame_count, synth.fxLate);
+            synth.fxCycles = 0;
+            synth.fxLate   = 0;
+#endif
 
             total_render = 0;
             total_write  = 0;
+            total_voice_ctl = 0;
+            count_voice_ctl = 0;
+            total_ghost_cycles = 0;
+            total_voice_mix = 0;
+            count_voice_mix = 0;
+            total_voice_mix_hi = 0;
+            count_voice_mix_hi = 0;
+            count_voice_filter_off = 0;
 #endif
             synth.updateActivity();
             frame_count  = 0;
@@ -343,6 +437,12 @@ void setup() {
     ESP_LOGI(TAG, "Reverb FX started");
 #endif
 
+#ifdef ENABLE_CONV_REVERB
+    if (convolver.loadWav(CONV_IR_FILE)) {
+        ESP_LOGI(TAG, "Convolution reverb: %d partitions (%.0f ms)", convolver.getPartitions(), convolver.getLengthMs());
+    }
+#endif
+
 #ifdef ENABLE_DELAY
     delayfx.init();
     ESP_LOGI(TAG, "Delay FX started");
@@ -366,6 +466,22 @@ void setup() {
     ESP_LOGI(TAG, "RGB LED started");
 #endif
 
+#ifdef ENABLE_DUAL_CORE_RENDER
+    TaskRenderHelper = xTaskCreateStaticPinnedToCore(
+        Synth::renderHelperTask, "RenderHelper",
+        sizeof(render_helper_stack)/sizeof(StackType_t),
+        &synth, 10, render_helper_stack, &render_helper_tcb, 0); // Core0, prio 10 (above control)
+    synth.setRenderHelper(TaskRenderHelper);
+#endif
+
+#ifdef ENABLE_FX_PIPELINE
+    TaskFx = xTaskCreateStaticPinnedToCore(
+        Synth::fxPipelineTask, "FxTask",
+        sizeof(fx_stack)/sizeof(StackType_t),
+        &synth, 9, fx_stack, &fx_tcb, 0); // Core0, prio 9 (below the render helper, above control)
+    synth.setFxTask(TaskFx);
+#endif
+
     Task1 = xTaskCreateStaticPinnedToCore(
         audio_task, "SynthTask",
         sizeof(audio_stack)/sizeof(StackType_t),
@@ -26,6 +26,8 @@
 
 // ===================== MISC  ======================================================================================
 const float DRAM_ATTR DIV_SAMPLE_RATE     = (1.0f/(float)SAMPLE_RATE);
+const float DRAM_ATTR DIV_BLOCK_LEN       = (1.0f/(float)DMA_BUFFER_LEN);
+const float DRAM_ATTR BLOCK_RATE          = ((float)SAMPLE_RATE/(float)DMA_BUFFER_LEN);
 const float DRAM_ATTR DIV_12              = (1.0f / 12.0f);
 const float DRAM_ATTR DIV_63              = (1.0f / 63.0f);
 const float DRAM_ATTR DIV_127             = (1.0f / 127.0f);
@@ -0,0 +1,257 @@
+/*
+ * ----------------------------------------------------------------------------
+ * ESP32-S3 optimized TPT (zero-delay feedback) state-variable filter
+ * after Vadim Zavalishin / Andrew Simper (trapezoidal integrators)
+ *
+ * Author: Evgeny Aslovskiy AKA Copych
+ * License: MIT
+ * Repository: https://github.com/copych/ESP32-S3_SF2_Sampler_Synthesizer
+ *
+ * File: svf.h
+ * Purpose: contains 3 classes + filter type selection:
+ *          SVF coefficient calculator with g = tan(pi*fc/fs) lookup table,
+ *          SVF low-pass with internal coefficients (voice filter),
+ *          SVF low-pass with shared coefficients (mono channel filter)
+ *
+ *  Unlike the direct form biquad, the SVF keeps its energy in the integrator
+ *  states, so coefficient changes cause no transients of their own and it is
+ *  unconditionally stable for any g > 0, k > 0 (i.e. any cutoff and Q).
+ *  Per-block modulation is still ramped (rampToLutPos) against zipper noise.
+ *  An update is one LUT read + one reciprocal, 3 coefficients are derived.
+ *  API mirrors BiquadCalc / BiquadFilter*Coeffs so both can be swapped with
+ *  ENABLE_SVF_FILTERS in config.h. Only the low-pass response is provided.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "biquad2.h"
+
+class SvfCalc {
+public:
+    struct Coeffs {
+        float g, k;         // g = tan(pi*fc/fs), k = 1/Q
+        float a1, a2, a3;   // a1 = 1/(1 + g*(g + k)), a2 = g*a1, a3 = g*a2
+    };
+
+private:
+    static constexpr size_t FreqSteps = 256;
+    static constexpr float  kPi       = 3.14159265358979323846f;
+    static constexpr float  Fs        = (float)SAMPLE_RATE;
+    static constexpr float  FreqMin   = 20.0f;
+    static constexpr float  FreqMax   = 20000.0f;
+    static constexpr float  QMin      = 0.5f;
+    static constexpr float  QMax      = FILTER_MAX_Q;
+
+    static constexpr float logFreqMin      = 2.9957323f;  // logf(20)
+    static constexpr float logFreqMax      = 9.9034876f;  // logf(20000)
+    static constexpr float invLogFreqRange = 1.0f / (logFreqMax - logFreqMin);
+
+    static void generateLUT() {
+        for (size_t i = 0; i < FreqSteps; ++i) {
+            const float t = float(i) / float(FreqSteps - 1);
+            const float f = expf(logFreqMin + t * (logFreqMax - logFreqMin));
+            gLut[i] = tanf(kPi * f / Fs);
+        }
+        lutInitialized = true;
+    }
+
+public:
+    static void ensureLUT() {
+        if (!lutInitialized) generateLUT();
+    }
+
+    // Same LUT-space convention as BiquadCalc: positions are linear in log(freq)
+    static constexpr float LutPosPerCent = 0.00057762265f * invLogFreqRange * (FreqSteps - 1); // ln(2)/1200
+
+    static BIQUAD_FORCE_INLINE float freqToLutPos(float freq) {
+        if (freq < FreqMin) freq = FreqMin; else if (freq > FreqMax) freq = FreqMax;
+        return (logf(freq) - logFreqMin) * invLogFreqRange * (FreqSteps - 1);
+    }
+
+    // The SVF needs no Q grid: the "Q position" is the damping k = 1/Q itself
+    static BIQUAD_FORCE_INLINE float qToLutPos(float Q) {
+        if (Q < QMin) Q = QMin; else if (Q > QMax) Q = QMax;
+        return 1.0f / Q;
+    }
+
+    static BIQUAD_FORCE_INLINE Coeffs calcLPAtLutPos(float freqPos, float k) {
+        if (freqPos < 0.0f) freqPos = 0.0f; else if (freqPos > float(FreqSteps - 1)) freqPos = float(FreqSteps - 1);
+        const size_t i0 = (size_t)freqPos;
+        const size_t i1 = (i0 + 1 < FreqSteps) ? i0 + 1 : FreqSteps - 1;
+        const float  t  = freqPos - float(i0);
+        const float  g  = gLut[i0] + t * (gLut[i1] - gLut[i0]);
+
+        Coeffs c;
+        c.g  = g;
+        c.k  = k;
+        c.a1 = 1.0f / (1.0f + g * (g + k));
+        c.a2 = g * c.a1;
+        c.a3 = g * c.a2;
+        return c;
+    }
+
+    // Drop-in for BiquadCalc::calcCoeffs(); every mode is rendered as LowPass
+    static Coeffs calcCoeffs(float freq, float Q, BiquadCalc::Mode mode = BiquadCalc::LowPass) {
+        (void)mode;
+        ensureLUT();
+        return calcLPAtLutPos(freqToLutPos(freq), qToLutPos(Q));
+    }
+
+private:
+    static DRAM_ATTR float gLut[FreqSteps];
+    static bool lutInitialized;
+};
+
+inline DRAM_ATTR float SvfCalc::gLut[SvfCalc::FreqSteps];
+inline bool SvfCalc::lutInitialized = false;
+
+// ================================================================================================
+
+class SvfFilterSharedCoeffs {
+public:
+    using Coeffs = SvfCalc::Coeffs;
+
+    SvfFilterSharedCoeffs() = default;
+
+    BIQUAD_FORCE_INLINE void setCoeffs(const Coeffs* coeffsPtr) {
+        coeffs = coeffsPtr;
+    }
+
+    BIQUAD_FORCE_INLINE void resetState() {
+        ic1 = ic2 = 0.0f;
+    }
+
+    // Single-sample (mono)
+    BIQUAD_FORCE_INLINE float BIQUAD_IRAM process(float in) {
+        if (UNLIKELY(coeffs == nullptr)) return in; // fail-safe
+        const Coeffs& c = *coeffs;
+
+        const float v3 = in - ic2;
+        const float v1 = c.a1 * ic1 + c.a2 * v3;
+        const float v2 = ic2 + c.a2 * ic1 + c.a3 * v3;
+        ic1 = 2.0f * v1 - ic1;
+        ic2 = 2.0f * v2 - ic2;
+        return v2;
+    }
+
+private:
+    const Coeffs* coeffs = nullptr;
+    float ic1 = 0.0f, ic2 = 0.0f;
+};
+
+// ================================================================================================
+
+class SvfFilterInternalCoeffs {
+public:
+    using Coeffs = SvfCalc::Coeffs;
+
+    SvfFilterInternalCoeffs() {
+        resetState();
+        updateCoeffs();     // freq/Q already hold the defaults: setFreqAndQ() would return early
+    }
+
+    BIQUAD_FORCE_INLINE void setFreq(float f) {
+        if (f != freq) { freq = f; updateCoeffs(); }
+    }
+    BIQUAD_FORCE_INLINE void setQ(float q) {
+        if (q != Q) { Q = q; updateCoeffs(); }
+    }
+    BIQUAD_FORCE_INLINE void setFreqAndQ(float f, float q) {
+        if (f != freq || q != Q) { freq = f; Q = q; updateCoeffs(); }
+    }
+
+    BIQUAD_FORCE_INLINE void resetState() {
+        ic1L = ic2L = ic1R = ic2R = 0.0f;
+        rampLeft = 0;
+    }
+
+    // LUT-position API shared with BiquadFilterInternalCoeffs (see SvfCalc).
+    BIQUAD_FORCE_INLINE void setLutPos(float freqPos, float k) {
+        coeffs   = SvfCalc::calcLPAtLutPos(freqPos, k);
+        rampLeft = 0;
+    }
+    // Glides linearly from the current coefficients to the ones at (freqPos, k) over n calls
+    // of process(), like the biquad. The state update is linear in a1..a3, so a blend is the
+    // same blend of two stable update matrices (checked over 20 Hz..20 kHz, Q 0.5..FILTER_MAX_Q:
+    // spectral radius stays below 1). g and k are not ramped, only a1..a3 are used per sample.
+    BIQUAD_FORCE_INLINE void rampToLutPos(float freqPos, float k, uint32_t n) {
+        const Coeffs t = SvfCalc::calcLPAtLutPos(freqPos, k);
+        const float  s = 1.0f / (float)n;
+        dCoeffs.a1 = (t.a1 - coeffs.a1) * s;
+        dCoeffs.a2 = (t.a2 - coeffs.a2) * s;
+        dCoeffs.a3 = (t.a3 - coeffs.a3) * s;
+        coeffs.g   = t.g;
+        coeffs.k   = t.k;
+        rampLeft   = n;
+    }
+
+    // Mono
+    BIQUAD_FORCE_INLINE float BIQUAD_IRAM process(float in) {
+        if (rampLeft) {
+            coeffs.a1 += dCoeffs.a1; coeffs.a2 += dCoeffs.a2; coeffs.a3 += dCoeffs.a3;
+            --rampLeft;
+        }
+        const float v3 = in - ic2L;
+        const float v1 = coeffs.a1 * ic1L + coeffs.a2 * v3;
+        const float v2 = ic2L + coeffs.a2 * ic1L + coeffs.a3 * v3;
+        ic1L = 2.0f * v1 - ic1L;
+        ic2L = 2.0f * v2 - ic2L;
+        return v2;
+    }
+
+    // Stereo LR in-place
+    BIQUAD_FORCE_INLINE void BIQUAD_IRAM processLR(float* __restrict inOutL,
+                                                   float* __restrict inOutR) {
+        if (rampLeft) {
+            coeffs.a1 += dCoeffs.a1; coeffs.a2 += dCoeffs.a2; coeffs.a3 += dCoeffs.a3;
+            --rampLeft;
+        }
+        const float a1 = coeffs.a1, a2 = coeffs.a2, a3 = coeffs.a3;
+
+        const float l3 = *inOutL - ic2L;
+        const float l1 = a1 * ic1L + a2 * l3;
+        const float l2 = ic2L + a2 * ic1L + a3 * l3;
+        ic1L = 2.0f * l1 - ic1L;
+        ic2L = 2.0f * l2 - ic2L;
+        *inOutL = l2;
+
+        const float r3 = *inOutR - ic2R;
+        const float r1 = a1 * ic1R + a2 * r3;
+        const float r2 = ic2R + a2 * ic1R + a3 * r3;
+        ic1R = 2.0f * r1 - ic1R;
+        ic2R = 2.0f * r2 - ic2R;
+        *inOutR = r2;
+    }
+
+private:
+    void updateCoeffs() {
+        coeffs   = SvfCalc::calcCoeffs(freq, Q);
+        rampLeft = 0;
+    }
+
+    float freq = 20000.0f;
+    float Q    = 0.707f;
+    Coeffs coeffs{};
+    Coeffs dCoeffs{};       // per-sample ramp step (see rampToLutPos)
+    uint32_t rampLeft = 0;
+
+    // States
+    float ic1L = 0.0f, ic2L = 0.0f, ic1R = 0.0f, ic2R = 0.0f;
+};
+
+// ================================================================================================
+// Filter type used by the SF2 voice filters and the mono channel filters
+
+#ifdef ENABLE_SVF_FILTERS
+    using FilterCalc         = SvfCalc;
+    using VoiceFilter        = SvfFilterInternalCoeffs;
+    using ChannelFilter      = SvfFilterInternalCoeffs;
+    using SharedCoeffsFilter = SvfFilterSharedCoeffs;
+#else
+    using FilterCalc         = BiquadCalc;
+    using VoiceFilter        = BiquadFilterInternalCoeffs;
+    using ChannelFilter      = BiquadFilterInternalCoeffs;
+    using SharedCoeffsFilter = BiquadFilterSharedCoeffs;
+#endif
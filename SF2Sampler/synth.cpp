@@ -48,12 +48,31 @@ extern SdFs SD;   // main.cpp’de tanıml
     #include "fx_reverb.h"
     extern FxReverb reverb;
 #endif
+#ifdef ENABLE_CONV_REVERB
+    #include "fx_convolver.h"
+    extern FxConvolver convolver;
+#endif
 
 #ifdef ENABLE_DELAY
     #include "fx_delay.h"
     extern FxDelay delayfx;
 #endif
 
+#if defined(ENABLE_DUAL_CORE_RENDER) && defined(ENABLE_CH_FILTER)
+    #error "ENABLE_DUAL_CORE_RENDER mixes from two cores and cannot share ENABLE_CH_FILTER channel buffers, use ENABLE_CH_FILTER_M"
+#endif
+
+#ifdef TASK_BENCHMARKING
+    extern uint32_t total_voice_ctl;
+    extern uint32_t count_voice_ctl;
+    extern uint32_t total_ghost_cycles;
+    extern uint32_t total_voice_mix;
+    extern uint32_t count_voice_mix;
+    extern uint32_t total_voice_mix_hi;
+    extern uint32_t count_voice_mix_hi;
+    extern uint32_t count_voice_filter_off;
+#endif
+
 inline int countActiveVoicesFast(const Voice* voices, int max) {
     int c = 0;
     for (int i = 0; i < max; ++i) if (voices[i].active) ++c;
@@ -62,6 +81,17 @@ inline int countActiveVoicesFast(const Voice* voices, int max) {
 
 static const char* TAG = "Synth";
 
+static constexpr float MASTER_GAIN = 0.30f;  // 0.25–0.35 arası denenebilir
+
+#ifdef ENABLE_VIRTUAL_VOICES
+static const float VIRTUAL_LEVEL = powf(10.0f, VOICE_VIRTUAL_DBFS / 20.0f) / MASTER_GAIN;
+#endif
+
+#ifdef ENABLE_VOICE_RETIRE
+// VOICE_RETIRE_DBFS, master kazancından önceki karışım seviyesine çevrilmiş hali
+static const float RETIRE_LEVEL = powf(10.0f, VOICE_RETIRE_DBFS / 20.0f) / MASTER_GAIN;
+#endif
+
 // Basit, hızlı yumuşak sınırlayıcı (tanh benzeri)
 static inline float soft_clip(float x) {
     float x2 = x * x;
@@ -76,13 +106,24 @@ Synth::Synth(SF2Parser& parserRef) : parser(parserRef) {
 
     // Initialize all voices
     for (int i = 0; i < MAX_VOICES; ++i) {
+        voices[i].cold = &voiceCold[i];
         voices[i].init();
     }
+#if GHOST_VOICES > 0
+    for (int g = 0; g < GHOST_VOICES; ++g) {
+        ghostStart[g].cold = &ghostStartCold[g];
+        ghostStart[g].init();
+    }
+#endif
 
     volume_scaler = 0.85f / sqrtf(MAX_VOICES);
+    CentsRatio::ensureLUT();
 }
 
 bool Synth::begin() {
+    ESP_LOGI(TAG, "Voice %u B (ampEnv @%u, block-rate @%u) + VoiceCold %u B, %d slots: %u B",
+             (unsigned)sizeof(Voice), (unsigned)offsetof(Voice, ampEnv), (unsigned)offsetof(Voice, sample),
+             (unsigned)sizeof(VoiceCold), MAX_VOICES, (unsigned)(MAX_VOICES * (sizeof(Voice) + sizeof(VoiceCold))));
     if (loadSynthState()) return true;
 
     if (!parser.parse()) {
@@ -104,6 +145,7 @@ void Synth::noteOn(uint8_t ch, uint8_t note, uint8_t vel) {
 #endif
 
     ChannelState* chan = &channels[ch];
+    noteOnSlots = 0;
 
     chan->activityIncrease(vel);
 
@@ -118,52 +160,55 @@ void Synth::noteOn(uint8_t ch, uint8_t note, uint8_t vel) {
     if (isMono) {
         if (retrig) {
             // Kill all existing voices on this channel
-            for (auto& v : voices)
-                if (v.active && v.channel == ch)
-                    v.die();
+            forVoices(voiceIndex.channel(ch), [](Voice& v, int) { v.die(); });
 
             // Start new voices for all zones
-            for (auto& zone : zones) {
-                if (!zone.sample) continue;
-                float score = vel * DIV_127;
-                Voice* v = allocateVoice(ch, note, score, zone.exclusiveClass);
-                if (v) v->startNew(ch, note, vel, zone, chan);
-            }
+            startVoices(ch, note, vel, zones, chan);
         } else {
             // Legato: update pitch of ALL existing voices, or start new if none
             bool reused = false;
-            for (Voice& v : voices) {
-                if (  v.active && v.channel == ch) {
-                    if (!v.noteHeld) {
-                        v.die();
-                    } else {
-                        v.updatePitchOnly(note, chan);
-                        reused = true;
-                    }
+            forVoices(voiceIndex.channel(ch), [&](Voice& v, int i) {
+                if (!v.noteHeld) {
+                    v.die();
+                } else {
+                    v.updatePitchOnly(note, chan);
+                    voiceIndex.moveNote(i, note);
+                    reused = true;
                 }
-            }
+            });
             if (!reused) {
                 // First note: start new voices
-                for (auto& zone : zones) {
-                    if (!zone.sample) continue;
-                    float score = vel * DIV_127;
-                    Voice* v = allocateVoice(ch, note, score, zone.exclusiveClass);
-                    if (v) v->startNew(ch, note, vel, zone, chan);
-                }
+                startVoices(ch, note, vel, zones, chan);
             }
         }
     } else {
         // Polyphonic: start new voices normally
-        for (auto& zone : zones) {
-            if (!zone.sample) continue;
-            float score = vel * DIV_127;
-            Voice* v = allocateVoice(ch, note, score, zone.exclusiveClass);
-            if (v) v->startNew(ch, note, vel, zone, chan);
-        }
+        startVoices(ch, note, vel, zones, chan);
     }
     chan->portaCurrentNote = note;
 }
 
+// Control thread: önce tüm katmanlara slot, sonra başlat. Çalınan (hâlâ çalan) slotların yeni
+// notası beklemeden sıraya girer, audio thread onu bir sonraki blok başında slota koyar.
+void Synth::startVoices(uint8_t ch, uint8_t note, uint8_t vel, const std::vector<Zone>& zones, ChannelState* chan) {
+    Voice*      slots[MAX_VOICES];
+    const Zone* layer[MAX_VOICES];
+    int n = 0;
+    for (const Zone& zone : zones) {
+        if (!zone.sample || n == MAX_VOICES) continue;
+        Voice* v = allocateVoice(ch, note, zone.exclusiveClass);
+        if (!v) continue;
+        slots[n] = v;
+        layer[n++] = &zone;
+    }
+    for (int i = 0; i < n; ++i) {
+#if GHOST_VOICES > 0
+        if (queueStart((int)(slots[i] - voices), ch, note, vel, *layer[i], chan)) continue;
+#endif
+        slots[i]->startNew(ch, note, vel, *layer[i], chan);
+    }
+}
+
 void Synth::noteOff(uint8_t ch, uint8_t note) {
     if (ch >= 16) return;
     
@@ -178,41 +223,141 @@ void Synth::noteOff(uint8_t ch, uint8_t note) {
     chan->removeNote(note);
     uint8_t nextNote = chan->topNote();
 
-    for (Voice& v : voices) {
-        if (!v.active || v.channel != ch) continue;
+    if (!isMono) {
+        // Poly mode: sadece bu (kanal, nota) üzerindeki sesler
+        forVoices(voiceIndex.note(ch, note), [](Voice& v, int) {
+            v.noteHeld = false;
+            v.stop();
+        });
+        return;
+    }
 
-        if (isMono) {
-            if (!chan->hasNotes()) {
-                // No more held notes → kill all
+    forVoices(voiceIndex.channel(ch), [&](Voice& v, int i) {
+        if (!chan->hasNotes()) {
+            // No more held notes → kill all
+            v.noteHeld = false;
+            v.stop();
+        } else if (isRetrig) {
+            if (v.note == note) {
                 v.noteHeld = false;
-                v.stop();
-            } else if (isRetrig) {
-                if (v.note == note) {
-                    v.noteHeld = false;
-                    v.die();
-                }
-            } else {
-                // MonoLegato: switch pitch of ALL voices to next note
-                if (v.note != nextNote) {
-                    v.updatePitchOnly(nextNote, chan);
-                }
+                v.die();
             }
         } else {
-            // Poly mode
-            if (v.note == note) {
-                v.noteHeld = false;
-                v.stop();
+            // MonoLegato: switch pitch of ALL voices to next note
+            if (v.note != nextNote) {
+                v.updatePitchOnly(nextNote, chan);
+                voiceIndex.moveNote(i, nextNote);
             }
         }
+    });
+}
+
+
+Voice*  __attribute__((always_inline))   Synth::allocateVoice(uint8_t ch, uint8_t note, uint32_t exclusiveClass){
+    if (exclusiveClass > 0) {
+        // Choke: aynı kanal + sınıftaki sesler hızlı release'e; bu note-on'un kendi katmanları hariç
+        forVoices(voiceIndex.exclusive(ch, exclusiveClass) & ~noteOnSlots, [&](Voice& v, int) {
+            if (v.exclusiveClass == exclusiveClass) v.choke();
+        });
     }
+
+    // Kurban seçimi audio thread'in blok başına yayınladığı skorlardan (envelope'a dokunmadan)
+    allocator.sync(scoreSnap);
+#ifdef ENABLE_POLY_GOVERNOR
+    const bool allowFree = countActiveVoicesFast(voices, MAX_VOICES) < governor.voiceCap();
+#else
+    const bool allowFree = true;
+#endif
+    const int slot = allocator.allocate(ch, note, allowFree);
+    if (slot < 0) return nullptr;      // bu blokta verilebilecek slot kalmadı: nota düşer
+    Voice* v = &voices[slot];
+    voiceIndex.add(slot, ch, note, (uint16_t)exclusiveClass);  // eski kayıtlar da burada düşer
+    noteOnSlots |= VoiceIndex<MAX_VOICES>::bit(slot);
+    return v;
 }
 
+#if GHOST_VOICES > 0
+// Control thread: çalınan ses kesilmesin. Yeni nota ghostStart[g]'de hazırlanır, slot sıraya
+// girer; audio thread blok başında eski sesi ghost'a kopyalar ve yenisini slota koyar (takeGhosts).
+// Bekleme yok. false: sessiz slot ya da tüm ghost'lar dolu (sert kesme), çağıran yerinde başlatır.
+bool Synth::queueStart(int slot, uint8_t ch, uint8_t note, uint8_t vel, const Zone& zone, ChannelState* chan) {
+    int g = lockPending(slot);          // bu blokta zaten çalınmış: bekleyen notası değişir
+    if (g < 0) {
+        const Voice& v = voices[slot];
+        if (!v.active || v.ampEnv.isIdle()) return false;
+        g = 0;
+        while (g < GHOST_VOICES && ghostReq[g] != GHOST_FREE) ++g;
+        if (g == GHOST_VOICES) {
+            ghostMisses++;
+            return false;
+        }
+        ghostSlot[g] = (int8_t)slot;
+        ghostPending |= VoiceIndex<MAX_VOICES>::bit(slot);
+    }
+    ghostStart[g].startNew(ch, note, vel, zone, chan);
+    __atomic_store_n(&ghostReq[g], (int8_t)(slot + 1), __ATOMIC_RELEASE);
+    return true;
+}
 
-Voice*  __attribute__((always_inline))   Synth::allocateVoice(uint8_t ch, uint8_t note, float newScore, uint32_t exclusiveClass){
-	Voice* v = findWeakestVoiceOnNote(ch, note, newScore, exclusiveClass);
-	if (!v) v = findWorstVoice();
-	return v;
+// Control thread: slotun yeni notası hâlâ ghostStart'ta mı? Öyleyse GHOST_EDIT ile kilitler ve
+// ghost indeksini döner (bırakmak: ghostReq = slot + 1). Audio thread devri yapmaktaysa (BUSY,
+// birkaç µs) bitmesini bekler; devir bitmişse -1, ses artık voices[slot]'ta.
+int Synth::lockPending(int slot) {
+    if (!(ghostPending & VoiceIndex<MAX_VOICES>::bit(slot))) return -1;
+    for (int g = 0; g < GHOST_VOICES; ++g) {
+        if (ghostSlot[g] != slot) continue;
+        for (;;) {
+            int8_t req = __atomic_load_n(&ghostReq[g], __ATOMIC_ACQUIRE);
+            if (req == slot + 1
+                && __atomic_compare_exchange_n(&ghostReq[g], &req, (int8_t)GHOST_EDIT, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return g;
+            }
+            if (req != GHOST_BUSY) break;
+        }
+    }
+    ghostPending &= ~VoiceIndex<MAX_VOICES>::bit(slot);
+    return -1;
 }
+
+// Control thread: bekleyen başlatmaları geri çek (reset, SF2 değişimi: zone'lar geçersizleşir)
+void Synth::cancelGhosts() {
+    for (int g = 0; g < GHOST_VOICES; ++g) {
+        for (;;) {
+            int8_t req = __atomic_load_n(&ghostReq[g], __ATOMIC_ACQUIRE);
+            if (req == GHOST_FREE) break;
+            if (req > 0
+                && __atomic_compare_exchange_n(&ghostReq[g], &req, (int8_t)GHOST_FREE, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+        }
+    }
+    ghostPending = 0;
+}
+
+// Audio thread, blok başında: sıradaki slotların eski sesini ghost'a kopyala, hazır bekleyen yeni
+// notayı slota koy. Kopyalar burada alındığı için hiçbir ses yarım yazılmış olamaz. Control thread
+// o an notayı düzenliyorsa (GHOST_EDIT) devir bir sonraki bloğa kalır.
+void IRAM_ATTR Synth::takeGhosts() {
+    for (int g = 0; g < GHOST_VOICES; ++g) {
+        int8_t req = __atomic_load_n(&ghostReq[g], __ATOMIC_ACQUIRE);
+        if (req <= 0 || !__atomic_compare_exchange_n(&ghostReq[g], &req, (int8_t)GHOST_BUSY, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) continue;
+        Voice& v = voices[req - 1];
+        if (v.active) {
+            ghosts[g] = v;
+            ghosts[g].fadeOut = true;
+            ghosts[g].active  = true;
+            ghostUses++;
+        }
+        VoiceCold* cold = v.cold;       // slotun kendi soğuk kısmı ve kimliği kalır
+        const int  id   = v.id;
+        *cold  = ghostStartCold[g];
+        v      = ghostStart[g];
+        v.cold = cold;
+        v.id   = id;
+        __atomic_store_n(&ghostReq[g], (int8_t)GHOST_FREE, __ATOMIC_RELEASE);
+    }
+}
+#endif
  
 
 void Synth::pitchBend(uint8_t ch, int value) {
@@ -262,12 +407,7 @@ void Synth::controlChange(uint8_t ch, uint8_t ctrl, uint8_t val) {
             state.expression = fval;
             break;
         case 10: // Pan
-            state.pan = fval;
-            for (Voice& v : voices) {
-                if ( v.channel == ch) {
-                    v.updatePan(); 
-                }
-            }
+            state.pan = fval;   // sesler pan'ı blok başına kendileri okur
             break;
         case 64: // Sustain Pedal
             {
@@ -275,11 +415,9 @@ void Synth::controlChange(uint8_t ch, uint8_t ctrl, uint8_t val) {
                 state.sustainPedal = sustainOn;
                 if (!sustainOn) {
                     // Release all sustained voices on this channel
-                    for (Voice& v : voices) {
-                        if (v.active && v.channel == ch && !v.noteHeld) {
-                            v.stop(); 
-                        }
-                    }
+                    forVoices(voiceIndex.channel(ch), [](Voice& v, int) {
+                        if (!v.noteHeld) v.stop();
+                    });
                 }
             }
             break;
@@ -289,25 +427,21 @@ void Synth::controlChange(uint8_t ch, uint8_t ctrl, uint8_t val) {
                 state.portamento = portamento;
             }
             break;
-#ifdef ENABLE_CH_FILTER
-        case 71: // Filter Resonance
+#if defined(ENABLE_CH_FILTER) || defined(ENABLE_CH_FILTER_M)
+        case 71: // Channel Filter Resonance
             state.filterResonance = knob_tbl[val] * (FILTER_MAX_Q - 0.5f) + 0.5f;
             state.recalcFilter();
             break;
-        case 74: // Filter Cutoff
+        case CH_FILTER_CUTOFF_CC: // Channel Filter Cutoff (CC#74 without voice filters, see config.h)
             state.filterCutoff = knob_tbl[val] * CH_FILTER_MAX_FREQ + CH_FILTER_MIN_FREQ;
             state.recalcFilter();
             break;
-#elif defined(ENABLE_CH_FILTER_M)
-        case 71: // Filter Resonance        
-            state.filterResonance = knob_tbl[val] * (FILTER_MAX_Q - 0.5f) + 0.5f;
-            state.filterCoeffs = BiquadCalc::calcCoeffs(state.filterCutoff, state.filterResonance, BiquadCalc::LowPass);
-            break;
-        case 74: // Filter Cutoff
-            state.filterCutoff = knob_tbl[val] * CH_FILTER_MAX_FREQ + CH_FILTER_MIN_FREQ;
-            state.filterCoeffs = BiquadCalc::calcCoeffs(state.filterCutoff, state.filterResonance, BiquadCalc::LowPass);
+#endif
+#ifdef ENABLE_IN_VOICE_FILTERS
+        case 74: // Brightness (voice filters)
+            state.brightness = (val - 64) * (1.0f / 64.0f) * VOICE_FILTER_CC74_CENTS;
             break;
-#endif        
+#endif
 
         case 72: // Release time modifier (64-centered)
             state.releaseModifier = knob_tbl[val] * 4.8072f; // 1.0 at val=64
@@ -342,6 +476,10 @@ void Synth::controlChange(uint8_t ch, uint8_t ctrl, uint8_t val) {
                     default:
 					case 2: setChannelMode(ch, ChannelState::Poly);
 				}
+			} else if (state.nrpn.msb == 0x01 && state.nrpn.lsb == 0x11) { // nrpn 0x01 0x11: channel polyphony cap (0 = none)
+				setVoiceLimits(ch, val, state.reservedVoices);
+			} else if (state.nrpn.msb == 0x01 && state.nrpn.lsb == 0x12) { // nrpn 0x01 0x12: reserved voices
+				setVoiceLimits(ch, state.maxVoices, val);
 			}
 			break;
 
@@ -438,35 +576,57 @@ void Synth::programChange(uint8_t ch, uint8_t program) {
 }
 
 
-void   __attribute__((hot,always_inline)) IRAM_ATTR Synth::renderLRBlock(float* outL, float* outR) {
-     float dryL[DMA_BUFFER_LEN] = {0};
-     float dryR[DMA_BUFFER_LEN] = {0};
-#ifdef ENABLE_CHORUS
-     float choL[DMA_BUFFER_LEN] = {0}, choR[DMA_BUFFER_LEN] = {0};
+// Audio thread: bir ses, bir blok → dry/send bus'ları. Ses burada pasifleşebilir
+// (envelope bitti, sample sonu).
+void __attribute__((hot)) IRAM_ATTR Synth::mixVoice(Voice& voice, MixBus& bus) {
+    float env[DMA_BUFFER_LEN];
+
+    // Ghost: çalınan sesin kopyası, bu blok boyunca sıfıra lineer iner. Soğuk kısmı
+    // (voice.cold) artık yeni notanın: modülasyon yok, pitch ve filtre son hallerinde kalır.
+    if (UNLIKELY(voice.fadeOut)) {
+        voice.phaseIncrementStep = 0.0f;
+        voice.gainStepL = -voice.gainL * DIV_BLOCK_LEN;
+        voice.gainStepR = -voice.gainR * DIV_BLOCK_LEN;
+    } else {
+#ifdef TASK_BENCHMARKING
+        const uint32_t tc0 = esp_cpu_get_cycle_count();
+        voice.updateModulators();
+        total_voice_ctl += esp_cpu_get_cycle_count() - tc0;
+        count_voice_ctl++;
+#else
+        voice.updateModulators();
 #endif
-#ifdef ENABLE_REVERB
-     float revL[DMA_BUFFER_LEN] = {0}, revR[DMA_BUFFER_LEN] = {0};
+    }
+
+    // Amplitude envelope: tüm blok tek seferde (segment geçişleri blok içinde).
+    // Sanal seslerde de çalışır: zamanlama birebir korunur.
+#ifdef ENABLE_VIRTUAL_VOICES
+    const float envPeak = voice.ampEnv.isDecaying() ? voice.ampEnv.getVal() : 1.0f;  // blok içi üst sınır
 #endif
-#ifdef ENABLE_DELAY
-     float delL[DMA_BUFFER_LEN] = {0}, delR[DMA_BUFFER_LEN] = {0};
+    voice.ampEnv.processBlock(env, DMA_BUFFER_LEN);
+    voice.envLast = env[DMA_BUFFER_LEN - 1];
+
+    // Tek kazanç rampası: velocity × tremolo × CC7 × CC11 × pan × global scaler
+    float gL = voice.gainL * volume_scaler;
+    float gR = voice.gainR * volume_scaler;
+    const float dL = voice.gainStepL * volume_scaler;
+    const float dR = voice.gainStepR * volume_scaler;
+    voice.gainL += voice.gainStepL * DMA_BUFFER_LEN;   // blok sonu = hedef
+    voice.gainR += voice.gainStepR * DMA_BUFFER_LEN;
+
+#ifdef ENABLE_VIRTUAL_VOICES
+    // Duyulmaz blok: sadece zaman ilerler (faz/döngü), örnek okuma/filtre/karışım yok
+    if (envPeak * fmaxf(fmaxf(gL, gL + dL * DMA_BUFFER_LEN), fmaxf(gR, gR + dR * DMA_BUFFER_LEN))
+            * (voice.sample ? voice.peak : 0.0f) < VIRTUAL_LEVEL) {
+        voice.virt = true;
+        voice.skipBlock();
+    } else
 #endif
-
-#ifdef ENABLE_CH_FILTER
-    // Clear channel dry buffers before mixing
-    for (int ch = 0; ch < 16; ++ch) {
-        memset(channels[ch].dryL, 0, sizeof(float)*DMA_BUFFER_LEN);
-        memset(channels[ch].dryR, 0, sizeof(float)*DMA_BUFFER_LEN);
-    }
+    {
+#ifdef ENABLE_VIRTUAL_VOICES
+        if (UNLIKELY(voice.virt)) voice.wake();
 #endif
 
-    for (int v = 0; v < MAX_VOICES; ++v) {
-        Voice& voice = voices[v];
-        if (!voice.active) continue;
-
-        // Çifte gain’i önlemek için sadece pan + global scaler
-        float volL = volume_scaler * voice.panL;
-        float volR = volume_scaler * voice.panR;
-
 #ifdef ENABLE_CHORUS
         float cAmt = voice.chorusAmount;
 #endif
@@ -483,29 +643,25 @@ void   __attribute__((hot,always_inline)) IRAM_ATTR Synth::renderLRBlock(float*
         float* dryRp = channels[voice.channel].dryR;
 #else
         // Mix directly into global dry buffers
-        float* dryLp = dryL;
-        float* dryRp = dryR;
+        float* dryLp = bus.dryL;
+        float* dryRp = bus.dryR;
 #endif
 
 #ifdef ENABLE_CHORUS
-        float* choLp = choL;
-        float* choRp = choR;
+        float* choLp = bus.choL;
+        float* choRp = bus.choR;
 #endif
 #ifdef ENABLE_REVERB
-        float* revLp = revL;
-        float* revRp = revR;
+        float* revLp = bus.revL;
+        float* revRp = bus.revR;
 #endif
 #ifdef ENABLE_DELAY
-        float* delLp = delL;
-        float* delRp = delR;
+        float* delLp = bus.delL;
+        float* delRp = bus.delR;
 #endif
 
-        for (int i = 0; i < DMA_BUFFER_LEN; ++i) {
-            float smp = voice.nextSample();   // ZATEN vel * volume * expression * env içerir
-
-            float l = smp * volL;
-            float r = smp * volR;
-
+        // Bus birikimi: mono ve linked stereo döngüleri ortak kullanır
+        auto accumulate = [&](int i, float l, float r) __attribute__((always_inline)) {
             dryLp[i] += l;
             dryRp[i] += r;
 
@@ -531,9 +687,237 @@ void   __attribute__((hot,always_inline)) IRAM_ATTR Synth::renderLRBlock(float*
             delLp[i] += lDel * dAmt;
             delRp[i] += rDel * dAmt;
 #endif
+        };
+
+#ifdef TASK_BENCHMARKING
+        const uint32_t tm0 = esp_cpu_get_cycle_count();
+        const bool highPitch = voice.effectivePhaseIncrement >= 2.0f;
+#endif
+
+        const int16_t* srcL = voice.data;
+        const int16_t* srcR = voice.dataR;
+#ifdef ENABLE_HOT_SAMPLES
+        // Atak bölgesindeki blok iç RAM kopyasından okur (profil: SF2Parser::placeHotSamples)
+        const bool hot = voice.hotBlock(srcL, srcR);
+        if (hot) hotBlocks[xPortGetCoreID()]++;     // çekirdek başına sayaç: iki render çekirdeği yarışmaz
+#else
+        const bool hot = false;
+#endif
+#ifdef ENABLE_SAMPLE_PREFETCH
+        // Bloğun okuyacağı aralık tek seferde DRAM'e; örnek döngüsü PSRAM beklemez.
+        // Her çekirdek kendi seslerini sırayla render eder → çekirdek başına bir tampon yeter.
+        if (!hot && !voice.prefetchBlock(prefetchBuf[xPortGetCoreID()], VOICE_PREFETCH_LEN, srcL, srcR)) {
+            prefetchFallbacks[xPortGetCoreID()]++;
+        }
+#endif
+
+#ifdef ENABLE_CH_FILTER_M
+        voice.setChannelFilter(!channels[voice.channel].filterOpen);
+#endif
+        // Örnekler (sadece env içerir): döngü/filtre/stereo birleşimine özel renderer
+        float smpL[DMA_BUFFER_LEN], smpR[DMA_BUFFER_LEN];
+        const int n = voice.selectRenderer()(voice, env, smpL, smpR, srcL, srcR);
+
+        if (srcR) {
+            // Linked stereo çift: tek faz/envelope, pan = balance
+            for (int i = 0; i < n; ++i) {
+                accumulate(i, smpL[i] * gL, smpR[i] * gR);
+                gL += dL;
+                gR += dR;
+            }
+        } else {
+            for (int i = 0; i < n; ++i) {
+                accumulate(i, smpL[i] * gL, smpL[i] * gR);
+                gL += dL;
+                gR += dR;
+            }
+        }
+
+#ifdef TASK_BENCHMARKING
+        const uint32_t tm = esp_cpu_get_cycle_count() - tm0;
+        total_voice_mix += tm;
+        count_voice_mix++;
+        if (highPitch) {
+            total_voice_mix_hi += tm;
+            count_voice_mix_hi++;
+        }
+#ifdef ENABLE_IN_VOICE_FILTERS
+        if (!voice.filterOn) count_voice_filter_off++;
+#endif
+#endif
+    }
+
+    // Envelope bu blokta bittiyse ses serbest (kalan örnekler zaten env = 0)
+    if (UNLIKELY(voice.ampEnv.isIdle())) voice.active = false;
+}
+
+// Audio thread / helper: voices first, first+stride, ... → bus
+void __attribute__((hot)) IRAM_ATTR Synth::mixVoices(int first, int stride, MixBus& bus) {
+    for (int v = first; v < MAX_VOICES; v += stride) {
+        Voice& voice = voices[v];
+        if (!voice.active) continue;
+        mixVoice(voice, bus);
+    }
+}
+
+#ifdef ENABLE_DUAL_CORE_RENDER
+// Core 0: her blokta audio task'tan bir bildirim bekler, tek indeksli sesleri kendi bus'ına
+// karıştırır ve audio task'a geri bildirir (bariyer = iki task notification)
+void IRAM_ATTR Synth::renderHelperTask(void* synthPtr) {
+    Synth& s = *static_cast<Synth*>(synthPtr);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#ifdef TASK_BENCHMARKING
+        const uint32_t c0 = esp_cpu_get_cycle_count();
+#endif
+        s.helperBus.clear();
+        s.mixVoices(1, 2, s.helperBus);
+#ifdef TASK_BENCHMARKING
+        s.coreRenderCycles[0] += esp_cpu_get_cycle_count() - c0;
+#endif
+        __sync_synchronize();
+        s.helperDone = true;
+        xTaskNotifyGive(s.audioTask);
+    }
+}
+#endif
+
+#ifdef ENABLE_FX_PIPELINE
+// Core 0: blok N-1'in efektleri ve master'ı, audio task blok N'in seslerini karıştırırken
+void IRAM_ATTR Synth::fxPipelineTask(void* synthPtr) {
+    Synth& s = *static_cast<Synth*>(synthPtr);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#ifdef TASK_BENCHMARKING
+        const uint32_t c0 = esp_cpu_get_cycle_count();
+#endif
+        s.processFx(s.fxBus[s.fxIndex], s.fxOutL, s.fxOutR);
+#ifdef TASK_BENCHMARKING
+        s.fxCycles += esp_cpu_get_cycle_count() - c0;
+#endif
+        __sync_synchronize();
+        s.fxDone = true;
+        if (s.fxWaiter) xTaskNotifyGive(s.fxWaiter);
+    }
+}
+#endif
+
+#ifdef ENABLE_POLY_GOVERNOR
+// Audio thread: cap üzerindeki sesleri (en sessizden, blok başına bir tane) hızlı release'e al
+void Synth::enforceVoiceCap() {
+    int    running = 0;
+    Voice* weakest = nullptr;
+    for (Voice& v : voices) {
+        if (!v.active || v.ampEnv.isReleasing()) continue;     // zaten sönüyor
+        running++;
+        if (!weakest || v.level < weakest->level) weakest = &v;
+    }
+    if (running > governor.voiceCap() && weakest) {
+        weakest->die();
+        governorRetired++;
+    }
+}
+#endif
+
+void   __attribute__((hot,always_inline)) IRAM_ATTR Synth::renderLRBlock(float* outL, float* outR) {
+#ifdef ENABLE_POLY_GOVERNOR
+    const uint32_t govStart = esp_cpu_get_cycle_count();
+#endif
+#ifdef ENABLE_FX_PIPELINE
+    MixBus& bus = fxBus[fxCur];     // diğer bus o sırada core 0'da işleniyor
+#else
+    MixBus bus;
+#endif
+    bus.clear();
+
+#if GHOST_VOICES > 0
+    takeGhosts();
+#endif
+
+#ifdef ENABLE_CH_FILTER
+    // Clear channel dry buffers before mixing
+    for (int ch = 0; ch < 16; ++ch) {
+        memset(channels[ch].dryL, 0, sizeof(float)*DMA_BUFFER_LEN);
+        memset(channels[ch].dryR, 0, sizeof(float)*DMA_BUFFER_LEN);
+    }
+#endif
+
+#ifdef ENABLE_DUAL_CORE_RENDER
+    // Sesler iki çekirdeğe dönüşümlü (çift/tek indeks) paylaşılır: allocator düşük
+    // indeksleri önce verdiği için yük dengeli kalır
+    if (LIKELY(helperTask != nullptr)) {
+        audioTask  = xTaskGetCurrentTaskHandle();
+        helperDone = false;
+        __sync_synchronize();
+        xTaskNotifyGive(helperTask);
+#ifdef TASK_BENCHMARKING
+        const uint32_t c1 = esp_cpu_get_cycle_count();
+#endif
+        mixVoices(0, 2, bus);
+#ifdef TASK_BENCHMARKING
+        coreRenderCycles[1] += esp_cpu_get_cycle_count() - c1;
+#endif
+        // Bildirim sadece uyandırır, bayrak belirler (efekt task'ı da bu task'a bildirim gönderir)
+        while (!helperDone) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        __sync_synchronize();
+
+        // Kısmi karışımları topla (efektlerden önce)
+        float* dst = (float*)&bus;
+        const float* src = (const float*)&helperBus;
+        for (size_t i = 0; i < sizeof(MixBus) / sizeof(float); ++i) dst[i] += src[i];
+    } else
+#endif
+    {
+        mixVoices(0, 1, bus);
+    }
+
+    for (int v = 0; v < MAX_VOICES; ++v) {
+        Voice& voice = voices[v];
+        if (!voice.active) continue;
+
+        // Çıkış seviyesi: blok sonu env × kazanç (volume_scaler dahil) × sample peak
+        voice.level = voice.sample ? voice.envLast * fmaxf(voice.gainL, voice.gainR) * volume_scaler * voice.peak : 0.0f;
+#ifdef ENABLE_VOICE_RETIRE
+        // Duyulmaz kuyruklar: sadece bırakılmış (release) sesler N blok sonra geri alınır.
+        // Basılı notalar (decay/sustain) kalır: seviye CC7/CC11 içerir, kanal kazancı geri gelebilir.
+        // Sanal sesler de bu yüzden basılıyken hiç geri alınmaz (bkz. VOICE_VIRTUAL_DBFS notu).
+        if (voice.level < RETIRE_LEVEL && voice.ampEnv.isReleasing()) {
+            if (++voice.quietBlocks >= VOICE_RETIRE_BLOCKS && voice.active) {
+                voice.kill();
+                retiredVoices++;
+            }
+        } else {
+            voice.quietBlocks = 0;
         }
+#endif
     }
 
+#if GHOST_VOICES > 0
+    // Çalınan seslerin kuyrukları: tek blokluk (~2.9 ms) lineer fade, sonra slot boşalır
+#ifdef TASK_BENCHMARKING
+    const uint32_t tg0 = esp_cpu_get_cycle_count();
+#endif
+    for (int g = 0; g < GHOST_VOICES; ++g) {
+        Voice& ghost = ghosts[g];
+        if (!ghost.active) continue;
+        mixVoice(ghost, bus);
+        ghost.active = false;
+    }
+#ifdef TASK_BENCHMARKING
+    total_ghost_cycles += esp_cpu_get_cycle_count() - tg0;
+#endif
+#endif
+
+#ifdef ENABLE_POLY_GOVERNOR
+    enforceVoiceCap();
+#endif
+
+    publishScores();
+#ifdef ENABLE_SHARED_VIB_LFO
+    // Kanal vibrato LFO'ları: blok başına bir adım, sesler oranı kontrol geçişinde okur
+    for (ChannelState& chan : channels) chan.vibLfo.tick(DMA_BUFFER_LEN, chan.modWheel);
+#endif
+
 #ifdef ENABLE_CH_FILTER
     // Process filters per channel and accumulate to global dry buffers
     for (int ch = 0; ch < 16; ++ch) {
@@ -545,36 +929,82 @@ void   __attribute__((hot,always_inline)) IRAM_ATTR Synth::renderLRBlock(float*
             float l = bufL[i];
             float r = bufR[i];
             PROCESS_FILTER_LR(chan.filter, l, r);
-            dryL[i] += l;
-            dryR[i] += r;
+            bus.dryL[i] += l;
+            bus.dryR[i] += r;
+        }
+    }
+#endif
+
+#ifdef ENABLE_FX_PIPELINE
+    if (LIKELY(fxTask != nullptr)) {
+#ifdef ENABLE_POLY_GOVERNOR
+        governor.update(esp_cpu_get_cycle_count() - govStart);
+        Voice::draftQuality = governor.isDraft();
+#endif
+        // Blok N-1'in efekt/master çıkışı (core 0) hazır olunca onu ver, blok N'yi core 0'a devret.
+        // Bildirimle beklenir, en fazla FX_WAIT_TICKS: efekt task'ı gecikirse bu blok sessiz çıkar,
+        // ses karışımı düşer ve core 0 elindeki bloğu bitirene kadar yeni blok verilmez.
+        fxWaiter = xTaskGetCurrentTaskHandle();
+        const TickType_t t0 = xTaskGetTickCount();
+        while (!fxDone && (xTaskGetTickCount() - t0) < FX_WAIT_TICKS) ulTaskNotifyTake(pdTRUE, 1);
+        if (UNLIKELY(!fxDone)) {
+            memset(outL, 0, sizeof(float) * DMA_BUFFER_LEN);
+            memset(outR, 0, sizeof(float) * DMA_BUFFER_LEN);
+            fxLate++;
+            return;
         }
+        __sync_synchronize();
+        memcpy(outL, fxOutL, sizeof(fxOutL));
+        memcpy(outR, fxOutR, sizeof(fxOutR));
+        fxDone  = false;
+        fxIndex = fxCur;
+        xTaskNotifyGive(fxTask);
+        fxCur ^= 1;
+        return;
     }
 #endif
+    processFx(bus, outL, outR);
 
+#ifdef ENABLE_POLY_GOVERNOR
+    governor.update(esp_cpu_get_cycle_count() - govStart);
+    Voice::draftQuality = governor.isDraft();
+#endif
+}
+
+// Efektler + master bölümü: dry/send bus'larından son stereo blok
+void __attribute__((hot)) IRAM_ATTR Synth::processFx(MixBus& bus, float* outL, float* outR) {
 #ifdef ENABLE_CHORUS
-    chorus.processBlock(choL, choR);
+    chorus.processBlock(bus.choL, bus.choR);
 #endif
 #ifdef ENABLE_DELAY
-    delayfx.ProcessBlock(delL, delR);
+    delayfx.ProcessBlock(bus.delL, bus.delR);
 #endif
 #ifdef ENABLE_REVERB
-    reverb.processBlock(revL, revR);
+#ifdef TASK_BENCHMARKING
+    const uint32_t r0 = esp_cpu_get_cycle_count();
+#endif
+#ifdef ENABLE_CONV_REVERB
+    if (!convolver.processBlock(bus.revL, bus.revR, reverb.getLevel()))
+#endif
+    reverb.processBlock(bus.revL, bus.revR);
+#ifdef TASK_BENCHMARKING
+    reverbCycles += esp_cpu_get_cycle_count() - r0;
+#endif
 #endif
 
     // --- MASTER HEADROOM + SOFT LIMITER ---
-    const float MASTER_GAIN = 0.30f;  // 0.25–0.35 arası denenebilir
 
     for (int i = 0; i < DMA_BUFFER_LEN; ++i) {
-        float l = dryL[i];
-        float r = dryR[i];
+        float l = bus.dryL[i];
+        float r = bus.dryR[i];
 #ifdef ENABLE_CHORUS
-        l += choL[i]; r += choR[i];
+        l += bus.choL[i]; r += bus.choR[i];
 #endif
 #ifdef ENABLE_REVERB
-        l += revL[i]; r += revR[i];
+        l += bus.revL[i]; r += bus.revR[i];
 #endif
 #ifdef ENABLE_DELAY
-        l += delL[i]; r += delR[i];
+        l += bus.delL[i]; r += bus.delR[i];
 #endif
 
         l *= MASTER_GAIN;
@@ -592,63 +1022,40 @@ void   __attribute__((hot,always_inline)) IRAM_ATTR Synth::renderLRBlock(float*
     }
 }
 
-
-Voice* Synth::findWeakestVoiceOnNote(uint8_t ch, uint8_t note, float newScore, uint32_t exclusiveClass) {
-    Voice* weakest = nullptr;
-    float weakestScore = FLT_MAX;
-    int count = 0;
-
-    for (int i = 0; i < MAX_VOICES; ++i) {
-        Voice& v = voices[i];
-        if (v.active && v.channel == ch) { 
-            if (v.exclusiveClass > 0 && v.exclusiveClass == exclusiveClass) {
-                v.die(); // Kill voices of the same class
-            }
-            if (v.note == note) {
-                count++;
-                v.updateScore();
-                if (v.score < weakestScore) {
-                    weakestScore = v.score;
-                    weakest = &v;
-                }
-            }
-        }
-    }
-
-    if (count >= MAX_VOICES_PER_NOTE && weakest)// && weakestScore < newScore)
-        return weakest;
-
-    return nullptr;
-}
-
-Voice* Synth::findWorstVoice() {
-    Voice* worst = nullptr;
-    float minScore = FLT_MAX;
-
+// Audio thread, blok sonunda: allocator için salt okunur skor resmi
+void IRAM_ATTR Synth::publishScores() {
+    VoiceScore* s = scoreSnap.beginWrite();
     for (int i = 0; i < MAX_VOICES; ++i) {
-        voices[i].updateScore();
-        if (!voices[i].active || !voices[i].isRunning()) return &voices[i];
-
-        if (voices[i].score < minScore) {
-            minScore = voices[i].score;
-            worst = &voices[i];
-        }
+        const Voice& v = voices[i];
+        s[i].active    = v.active ? 1 : 0;
+        s[i].channel   = (uint8_t)v.channel;
+        s[i].note      = (uint8_t)v.note;
+        s[i].releasing = v.ampEnv.isReleasing() ? 1 : 0;
+        s[i].age       = (uint32_t)v.samplesRun;
+        // Yükselen envelope'ta (attack/hold) varacağı seviyeyi say: taze notalar çalınmasın
+        const float env = v.ampEnv.isDecaying() ? v.envLast : 1.0f;
+        s[i].level     = (v.active && v.sample)
+                       ? env * fmaxf(v.gainL, v.gainR) * volume_scaler * v.peak
+                       : 0.0f;
     }
-
-    return worst;
+    scoreSnap.endWrite();
 }
 
-void Synth::updateScores() {
-    // Audio thread dışı: yalnızca skor güncelle
+void Synth::updateVoiceControls() {
+    // Audio thread dışı: vibrato/portamento faktörleri (envelope'a dokunmaz)
+#ifdef ENABLE_SHARED_VIB_LFO
+    for (ChannelState& chan : channels) chan.vibLfo.sweep();
+#endif
     for (Voice& v : voices) {
-        v.updateScore();
         if (!v.active) continue;
-        v.updatePitch();
-        v.updatePitchFactors();
+        v.updatePitchFactors();     // phase increment itself is ramped per block on the audio thread
     }
 }
 
 void Synth::reset() {
+#if GHOST_VOICES > 0
+    cancelGhosts();
+#endif
     for (int ch = 0; ch < 16; ++ch) {
         channels[ch].reset();   
     }
@@ -656,28 +1063,26 @@ void Synth::reset() {
     for (Voice& v : voices) {
         v.kill();
     }
+    voiceIndex.clear();
 }
 
 void Synth::soundOff(uint8_t ch) {
     if (ch >= 16) return;
-    for (Voice& v : voices) {
-        if (v.active && v.channel == ch) {
-            v.kill();
-        }
-    }
+    forVoices(voiceIndex.channel(ch), [&](Voice& v, int i) {
+        v.kill();
+        voiceIndex.remove(i);
+    });
 }
 
 void Synth::allNotesOff(uint8_t ch) {
     if (ch >= 16) return;
-    for (Voice& v : voices) {
-        if (v.active && v.channel == ch) {
-            if (*v.modSustain) {
-               // v.sustainHeld = true; // wait until pedal release
-            } else {
-                v.stop();
-            }
+    forVoices(voiceIndex.channel(ch), [](Voice& v, int) {
+        if (*v.cold->modSustain) {
+           // v.sustainHeld = true; // wait until pedal release
+        } else {
+            v.stop();
         }
-    }
+    });
 }
 
 void Synth::GMReset() {
@@ -758,8 +1163,13 @@ bool Synth::handleSysEx(const uint8_t* data, size_t len) {
                 setChannelMode(part, mono ? ChannelState::MonoLegato : ChannelState::Poly );
                 ESP_LOGI(TAG, "Received XG Mono/Poly SysEx: Part %u → %s", part + 1, mono ? "Mono" : "Poly");
                 return true;
+            } else if (param == 0x00) {
+                setVoiceLimits(part, state.maxVoices, val);
+                ESP_LOGI(TAG, "Received XG element reserve SysEx: Part %u → %u", part + 1, val);
+                return true;
             } else if (param == 0x08) {
                 state.tuningSemitones = val - 64.0f;
+                state.tuning.setShift(state.tuningSemitones);
                 ESP_LOGI(TAG, "Received XG part note shift SysEx: Part %u → %d", part + 1, (int)(val-64.0f));
                 return true;
             } else if (param == 0x07) {
@@ -778,11 +1188,107 @@ bool Synth::handleSysEx(const uint8_t* data, size_t len) {
             }
         }
     }
+
+#ifdef ENABLE_MICROTUNING
+    // MIDI Tuning Standard (F0 7E/7F dev 08 ...). Tuning programs / banks are not kept:
+    // note-based messages retune every channel, scale/octave ones the channels in their bitmap.
+    if (len >= 6 && data[0] == 0xF0 && (data[1] == 0x7E || data[1] == 0x7F) &&
+        data[3] == 0x08 && data[len - 1] == 0xF7) {
+        const uint8_t sub = data[4];
+        if (sub == 0x01 && len >= 22 + 128 * 3 + 1) {
+            // Bulk tuning dump: tt, 16 byte name, 128 × (xx yy zz), checksum
+            applyMtsNotes(data + 22, 128, true, 0xFFFF);
+            ESP_LOGI(TAG, "Received MTS bulk tuning dump \"%.16s\"", (const char*)data + 6);
+            return true;
+        }
+        if ((sub == 0x02 && len >= 8) || (sub == 0x07 && len >= 9)) {
+            // Single note tuning change (+ bank): ll × (kk xx yy zz)
+            const uint8_t* p   = data + (sub == 0x02 ? 6 : 7);
+            const int      fit = (int)(len - 1 - (p + 1 - data)) / 4;    // F7 hariç
+            const int      cnt = (p[0] < fit) ? p[0] : fit;
+            applyMtsNotes(p + 1, cnt, false, 0xFFFF);
+            ESP_LOGI(TAG, "Received MTS single note tuning: %d keys", cnt);
+            return true;
+        }
+        if ((sub == 0x08 && len >= 8 + 12 + 1) || (sub == 0x09 && len >= 8 + 24 + 1)) {
+            // Scale/octave tuning, 1 byte (±64 cents) or 2 byte (±100 cents, 14 bit) per pitch class
+            const uint16_t chMask = ((data[5] & 0x03) << 14) | ((data[6] & 0x7F) << 7) | (data[7] & 0x7F);
+            float offs[12];
+            for (int pc = 0; pc < 12; ++pc) {
+                offs[pc] = (sub == 0x08)
+                    ? (float)((int)data[8 + pc] - 64)
+                    : (float)((((int)data[8 + 2 * pc] << 7) | data[9 + 2 * pc]) - 8192) * (100.0f / 8192.0f);
+            }
+            for (int ch = 0; ch < 16; ++ch) {
+                if (!(chMask & (1 << ch))) continue;
+                for (int pc = 0; pc < 12; ++pc) channels[ch].tuning.setPitchClassCents(pc, offs[pc]);
+            }
+            ESP_LOGI(TAG, "Received MTS scale/octave tuning, channels 0x%04X", chMask);
+            return true;
+        }
+    }
+#endif
 	
     return false;
      
 }
 
+#ifdef ENABLE_MICROTUNING
+// MTS frequency data: xx = 12-TET semitone, yy zz = 14 bit fraction of a semitone; 7F 7F 7F = no change
+void Synth::applyMtsNotes(const uint8_t* p, int count, bool bulk, uint16_t chMask) {
+    for (int i = 0; i < count; ++i) {
+        const uint8_t* e   = bulk ? p + 3 * i : p + 4 * i + 1;
+        const uint8_t  key = bulk ? (uint8_t)i : (p[4 * i] & 0x7F);
+        if (e[0] == 0x7F && e[1] == 0x7F && e[2] == 0x7F) continue;
+        const float cents = 100.0f * (float)e[0] + (float)((e[1] << 7) | e[2]) * (100.0f / 16384.0f);
+        for (int ch = 0; ch < 16; ++ch)
+            if (chMask & (1 << ch)) channels[ch].tuning.setNoteCents(key, cents);
+    }
+}
+
+// Scala tuning from the SD card; relative names are looked up in SCALA_PATH.
+// kbm = nullptr: linear mapping, degree 0 on middle C. Returns false if a file is missing or invalid.
+bool Synth::loadScala(const char* scl, const char* kbm, uint16_t chMask) {
+    auto readText = [](const char* name, String& out) -> bool {
+        String path = String(SCALA_PATH);
+        if (name[0] == '/') path = ""; else path += '/';
+        path += name;
+        FsFile f;
+        if (!f.open(path.c_str(), O_RDONLY)) {
+            ESP_LOGE(TAG, "Can't open %s", path.c_str());
+            return false;
+        }
+        const size_t n = (size_t)f.fileSize();
+        if (n > 16384) { f.close(); ESP_LOGE(TAG, "%s is too large", path.c_str()); return false; }
+        char* buf = (char*)malloc(n + 1);
+        if (!buf) { f.close(); return false; }
+        const int got = f.read(buf, n);
+        f.close();
+        buf[got > 0 ? got : 0] = 0;
+        out = buf;
+        free(buf);
+        return true;
+    };
+
+    String sclText, kbmText;
+    if (!readText(scl, sclText)) return false;
+    if (kbm && !readText(kbm, kbmText)) return false;
+
+    TuningTable t;
+    if (!t.fromScala(sclText.c_str(), kbm ? kbmText.c_str() : nullptr)) {
+        ESP_LOGE(TAG, "Invalid Scala tuning %s", scl);
+        return false;
+    }
+    for (int ch = 0; ch < 16; ++ch)
+        if (chMask & (1 << ch)) channels[ch].tuning.copyNotes(t);
+    return true;
+}
+
+void Synth::resetTuning() {
+    for (auto& c : channels) c.tuning.resetNotes();
+}
+#endif
+
 fs::FS* Synth::getFileSystem() {
     switch (fsType) {
         case FileSystemType::LITTLEFS: return &LittleFS;
@@ -832,8 +1338,11 @@ bool Synth::loadSf2File(const char* filename) {
         return false;
     }
 
-    parser = std::move(tempParser);
+    // Eski dosya: sesler durur, çalma sayıları kaydedilir, sample belleği bırakılır.
+    // Move-assign bunları yapmaz (menüden yüklemede sayılar kayboluyordu).
     reset();
+    parser.clear();
+    parser = std::move(tempParser);
     GMReset();
     return true;
 }
@@ -852,6 +1361,18 @@ bool Synth::loadNextSf2() {
     return loadSf2File(sf2Files[currentFileIndex].c_str());
 }
 
+// Kanal polifoni sınırı (0 = yok) ve rezerv: ChannelState'te saklanır, allocator'a iletilir
+void Synth::setVoiceLimits(uint8_t ch, uint8_t maxVoices, uint8_t reserved) {
+    if (ch >= 16) return;
+    if (maxVoices > MAX_VOICES) maxVoices = MAX_VOICES;
+    if (reserved > MAX_VOICES / 2) reserved = MAX_VOICES / 2;      // herkese yer kalsın
+    if (maxVoices && reserved > maxVoices) reserved = maxVoices;
+    channels[ch].maxVoices      = maxVoices;
+    channels[ch].reservedVoices = reserved;
+    allocator.setChannelLimits(ch, maxVoices, reserved);
+    ESP_LOGI(TAG, "Ch%u voices: max %u (0 = no cap), reserved %u", ch + 1, maxVoices, reserved);
+}
+
 void Synth::setChannelMode(uint8_t ch, ChannelState::MonoMode mode) {
     channels[ch].monoMode = mode;
     channels[ch].clearNoteStack();
@@ -864,7 +1385,15 @@ void Synth::printState() {
         if (voices[i].active) activeCount++;
         ESP_LOGD(TAG, "%d: id=%d seg=%s val=%.5f target=%.5f", i, voices[i].id, voices[i].ampEnv.getCurrentSegmentStr(), voices[i].ampEnv.getVal(),voices[i].ampEnv.getTarget() );
     }
-    ESP_LOGI(TAG, "active %d/%d ", activeCount, MAX_VOICES);
+    ESP_LOGI(TAG, "active %d/%d", activeCount, MAX_VOICES);
+#ifdef ENABLE_VOICE_RETIRE
+    ESP_LOGI(TAG, "retired below %.0f dBFS: %u", (float)VOICE_RETIRE_DBFS, retiredVoices);
+#endif
+#ifdef ENABLE_POLY_GOVERNOR
+    ESP_LOGI(TAG, "governor: load %.2f, voice cap %d/%d, draft %d, overruns %u, retired %u",
+             governor.load(), governor.voiceCap(), MAX_VOICES, governor.isDraft(), governor.getOverruns(), governorRetired);
+#endif
+    ESP_LOGI(TAG, "steals faded in ghost slots: %u, hard cuts (no free slot): %u", ghostUses, ghostMisses);
 
 }
 
@@ -899,7 +1428,9 @@ bool Synth::loadSf2ByIndex(int index) {
 
 bool Synth::saveSynthState(const char* path) {
 
-
+#ifdef ENABLE_HOT_SAMPLES
+    parser.savePlayCounts();
+#endif
     fs::FS* fs = &SD_MMC;
     if (!fs) return false;
     File f = fs->open(path, FILE_WRITE);
@@ -922,10 +1453,12 @@ bool Synth::saveSynthState(const char* path) {
             (uint8_t)channels[ch].wantProgram
         };
         writeTLV(f, PARAM_CHANNEL(ch), data, 3);
+        const uint8_t voicesData[2] = { channels[ch].maxVoices, channels[ch].reservedVoices };
+        writeTLV(f, PARAM_CH_VOICES(ch), voicesData, 2);
     }
 
 #ifdef ENABLE_REVERB
-    float rtime = reverb.getTime();
+    float rtime = reverb.getTimeRaw();     // setTime() argument, round-trips through loadSynthState
     float rdamp = reverb.getDamping();
     writeTLV(f, PARAM_REVERB_TIME, &rtime, sizeof(rtime));
     writeTLV(f, PARAM_REVERB_DAMP, &rdamp, sizeof(rdamp));
@@ -961,6 +1494,9 @@ bool Synth::loadSynthState(const char* path) {
             channels[ch].wantProgram = b[2];
             applyBankProgram(ch);
         }
+        if (auto it = map.find(PARAM_CH_VOICES(ch)); it != map.end() && it->second.len == 2) {
+            setVoiceLimits(ch, it->second.data[0], it->second.data[1]);
+        }
     }
 
 #ifdef ENABLE_REVERB
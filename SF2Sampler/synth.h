@@ -26,6 +26,24 @@
 #include "channel.h"
 #include "voice.h"
 #include "SF2Parser.h"
+#include "voice_alloc.h"
+#include "voice_index.h"
+#include "governor.h"
+
+// Dry + effect send buses one block of voices is mixed into
+struct MixBus {
+    float dryL[DMA_BUFFER_LEN], dryR[DMA_BUFFER_LEN];
+#ifdef ENABLE_CHORUS
+    float choL[DMA_BUFFER_LEN], choR[DMA_BUFFER_LEN];
+#endif
+#ifdef ENABLE_REVERB
+    float revL[DMA_BUFFER_LEN], revR[DMA_BUFFER_LEN];
+#endif
+#ifdef ENABLE_DELAY
+    float delL[DMA_BUFFER_LEN], delR[DMA_BUFFER_LEN];
+#endif
+    inline void clear() { memset(this, 0, sizeof(MixBus)); }
+};
 
 enum class FileSystemType {
     LITTLEFS,
@@ -42,12 +60,16 @@ public:
     void controlChange(uint8_t ch, uint8_t control, uint8_t value);
     void allNotesOff(uint8_t ch);
     bool handleSysEx(const uint8_t* data, size_t len); 
+#ifdef ENABLE_MICROTUNING
+    bool loadScala(const char* scl, const char* kbm = nullptr, uint16_t chMask = 0xFFFF);
+    void resetTuning();             // all channels back to 12-TET (XG note shift kept)
+#endif
     void soundOff(uint8_t ch);
     void reset();
     void applyBankProgram(uint8_t ch);
     void programChange(uint8_t channel, uint8_t program);
     void pitchBend(uint8_t ch, int value);
-    void updateScores();
+    void updateVoiceControls();
     void printState();
     void renderLR(float* sampleL, float* sampleR);
     void GMReset(); 
@@ -69,6 +91,43 @@ public:
     bool loadSynthState(const char* path=DEFAULT_CONFIG_FILE);
     bool saveSynthState(const char* path=DEFAULT_CONFIG_FILE);
     const String& getCurrentSf2Path() const { return currentSf2Path; }
+    void setStealPolicy(StealPolicy p) { allocator.setPolicy(p); }
+    void setVoiceLimits(uint8_t ch, uint8_t maxVoices, uint8_t reserved);
+#ifdef ENABLE_VOICE_RETIRE
+    uint32_t retiredVoices = 0;     // released voices reclaimed from inaudible tails
+#endif
+#ifdef ENABLE_POLY_GOVERNOR
+    const PolyGovernor& getGovernor() const { return governor; }
+    uint32_t governorRetired = 0;   // voices released because they were above the governor cap
+#endif
+    uint32_t ghostUses   = 0;       // stolen voices faded out in a ghost slot
+    uint32_t ghostMisses = 0;       // steals with all ghost slots busy (hard cut)
+#ifdef ENABLE_SAMPLE_PREFETCH
+    uint32_t prefetchFallbacks[portNUM_PROCESSORS] = {}; // per rendering core: voice-blocks whose span did not fit VOICE_PREFETCH_LEN
+#endif
+#ifdef ENABLE_HOT_SAMPLES
+    uint32_t hotBlocks[portNUM_PROCESSORS] = {};         // per rendering core: voice-blocks read from an internal RAM attack copy
+#endif
+#ifdef ENABLE_REVERB
+    volatile uint32_t reverbCycles = 0; // reverb processBlock cycles (TASK_BENCHMARKING)
+#endif
+
+#ifdef ENABLE_DUAL_CORE_RENDER
+    // Core 0 helper task: renders every odd voice into its own bus while the audio task
+    // renders the even ones. Create it with this function and register the handle.
+    static void renderHelperTask(void* synthPtr);
+    void setRenderHelper(TaskHandle_t helper) { helperTask = helper; }
+    volatile uint32_t coreRenderCycles[2] = {0, 0};    // voice mixing cycles per core (TASK_BENCHMARKING)
+#endif
+
+#ifdef ENABLE_FX_PIPELINE
+    // Core 0 effects task: effects + master for block N-1 while the audio task mixes block N.
+    // Create it with this function and register the handle.
+    static void fxPipelineTask(void* synthPtr);
+    void setFxTask(TaskHandle_t task) { fxTask = task; }
+    volatile uint32_t fxCycles = 0;                     // effects + master cycles (TASK_BENCHMARKING)
+    uint32_t fxLate = 0;                                // blocks output silent: effects task not done within FX_WAIT_TICKS
+#endif
 
 private:
     
@@ -76,11 +135,86 @@ private:
     float volume_scaler = 0.5f ;
     int currentFileIndex = -1;
     float pitchBendRatio(int value);
-    Voice* allocateVoice(uint8_t ch, uint8_t note, float newScore, uint32_t exclusiveClass);
-    Voice* findWeakestVoiceOnNote(uint8_t ch, uint8_t note, float newScore, uint32_t exclusiveClass);
-    Voice* findWorstVoice();
+    Voice* allocateVoice(uint8_t ch, uint8_t note, uint32_t exclusiveClass);
+    void startVoices(uint8_t ch, uint8_t note, uint8_t vel, const std::vector<Zone>& zones, ChannelState* chan);
+#if GHOST_VOICES > 0
+    bool queueStart(int slot, uint8_t ch, uint8_t note, uint8_t vel, const Zone& zone, ChannelState* chan);
+    int  lockPending(int slot);
+    void cancelGhosts();
+    void takeGhosts();
+#endif
+#ifdef ENABLE_MICROTUNING
+    void applyMtsNotes(const uint8_t* p, int count, bool bulk, uint16_t chMask);
+#endif
+    void publishScores();
+    void mixVoice(Voice& voice, MixBus& bus);
+    void mixVoices(int first, int stride, MixBus& bus);
+    void processFx(MixBus& bus, float* outL, float* outR);
+
+    // Control thread: call f(voice, slot) for each still active voice in the mask;
+    // slots the audio thread has retired meanwhile are dropped from the index here.
+    // A stolen slot whose new note still waits for the audio thread is edited in its ghostStart.
+    template <typename F>
+    inline void forVoices(VoiceIndex<MAX_VOICES>::Mask m, F&& f) {
+        while (m) {
+            const int i = __builtin_ctzll(m);
+            m &= m - 1;
+#if GHOST_VOICES > 0
+            if (ghostPending & VoiceIndex<MAX_VOICES>::bit(i)) {
+                const int g = lockPending(i);
+                if (g >= 0) {
+                    f(ghostStart[g], i);
+                    __atomic_store_n(&ghostReq[g], (int8_t)(i + 1), __ATOMIC_RELEASE);
+                    continue;
+                }
+            }
+#endif
+            if (!voices[i].active) { voiceIndex.remove(i); continue; }
+            f(voices[i], i);
+        }
+    }
+
+    Voice     voices[MAX_VOICES];           // hot: per-sample render state, 32-byte aligned records
+    VoiceCold voiceCold[MAX_VOICES];        // cold: zone copy, modulation sources/state (voices[i].cold)
+    VoiceIndex<MAX_VOICES> voiceIndex;      // control thread: slots per channel / (channel, note) / exclusive class
+    VoiceIndex<MAX_VOICES>::Mask noteOnSlots = 0;   // slots started by the current noteOn (not choked by its own layers)
+#ifdef ENABLE_SAMPLE_PREFETCH
+    alignas(16) int16_t prefetchBuf[portNUM_PROCESSORS][2 * VOICE_PREFETCH_LEN];   // per rendering core: L | R
+#endif
+#if GHOST_VOICES > 0
+    static constexpr int8_t GHOST_FREE = 0, GHOST_BUSY = -1, GHOST_EDIT = -2;
+    Voice     ghosts[GHOST_VOICES];         // fade-out copies of stolen voices, one block each
+    Voice     ghostStart[GHOST_VOICES];     // control thread: the new note of a stolen slot, swapped in by takeGhosts()
+    VoiceCold ghostStartCold[GHOST_VOICES];
+    volatile int8_t ghostReq[GHOST_VOICES] = {};    // control → audio: stolen slot + 1; GHOST_BUSY while swapped, GHOST_EDIT while control edits ghostStart
+    int8_t    ghostSlot[GHOST_VOICES] = {}; // control thread: slot of the last request per ghost
+    VoiceIndex<MAX_VOICES>::Mask ghostPending = 0;  // control thread: slots whose new note may still wait in ghostStart
+#endif
+    ScoreSnapshot<MAX_VOICES>  scoreSnap;   // written by the audio thread once per block
+    VoiceAllocator<MAX_VOICES> allocator;   // used by the control thread (note on)
+#ifdef ENABLE_POLY_GOVERNOR
+    PolyGovernor governor;                  // updated by the audio thread
+    void enforceVoiceCap();
+#endif
+
+#ifdef ENABLE_DUAL_CORE_RENDER
+    MixBus       helperBus;                 // core 0 partial mix, summed by the audio task
+    TaskHandle_t helperTask = nullptr;
+    TaskHandle_t audioTask  = nullptr;
+    volatile bool helperDone = false;       // core 0 finished its half of the voices (notification only wakes)
+#endif
 
-    Voice voices[MAX_VOICES];
+#ifdef ENABLE_FX_PIPELINE
+    MixBus       fxBus[2];                  // double-buffered hand-off audio task → effects task
+    float        fxOutL[DMA_BUFFER_LEN] = {0};
+    float        fxOutR[DMA_BUFFER_LEN] = {0};
+    volatile uint32_t fxIndex = 0;          // bus the effects task works on
+    volatile bool fxDone = true;            // effects task finished fxIndex (fxOut is valid)
+    uint32_t     fxCur  = 0;                // bus the audio task mixes into
+    TaskHandle_t fxTask = nullptr;
+    TaskHandle_t fxWaiter = nullptr;        // audio task, woken by the effects task when fxDone
+    static constexpr TickType_t FX_WAIT_TICKS = 2;  // ≤ 2 ms (1 kHz tick), under one block
+#endif
 
     fs::FS* getFileSystem() ;
 
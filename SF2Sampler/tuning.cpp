@@ -0,0 +1,147 @@
+/*
+ * ----------------------------------------------------------------------------
+ * ESP32-S3 SF2 Synthesizer Firmware
+ *
+ * Author: Evgeny Aslovskiy AKA Copych
+ * License: MIT
+ * Repository: https://github.com/copych/ESP32-S3_SF2_Sampler_Synthesizer
+ *
+ * File: tuning.cpp
+ * Purpose: Scala .scl / .kbm parsing into a TuningTable
+ * ----------------------------------------------------------------------------
+ */
+
+#include "tuning.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char* TAG = "Tuning";
+
+#ifdef ENABLE_MICROTUNING
+
+// Next non-comment line (Scala: '!' starts a comment line), trimmed; false at end of text
+static bool nextLine(const char*& p, char* out, size_t cap) {
+    while (p && *p) {
+        const char* e = p;
+        while (*e && *e != '\n' && *e != '\r') ++e;
+        const bool comment = (*p == '!');
+        size_t n = 0;
+        if (!comment) {
+            const char* s = p;
+            while (s < e && (*s == ' ' || *s == '\t')) ++s;
+            const char* t = e;
+            while (t > s && (t[-1] == ' ' || t[-1] == '\t')) --t;
+            n = (size_t)(t - s) < cap - 1 ? (size_t)(t - s) : cap - 1;
+            memcpy(out, s, n);
+        }
+        out[n] = 0;
+        p = e;
+        if (*p == '\r') ++p;
+        if (*p == '\n') ++p;
+        if (!comment) return true;
+    }
+    return false;
+}
+
+// Scala pitch: "701.955" = cents, "3/2" or "2" = ratio
+static bool parsePitch(const char* s, float& cents) {
+    char* end = nullptr;
+    if (strchr(s, '.') && (!strchr(s, '/') || strchr(s, '.') < strchr(s, '/'))) {
+        cents = strtof(s, &end);
+        return end != s;
+    }
+    const long num = strtol(s, &end, 10);
+    if (end == s || num <= 0) return false;
+    long den = 1;
+    if (*end == '/') {
+        const char* d = end + 1;
+        den = strtol(d, &end, 10);
+        if (end == d || den <= 0) return false;
+    }
+    cents = 1200.0f * log2f((float)num / (float)den);
+    return true;
+}
+
+static inline int floorDiv(int a, int b) {
+    int q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0))) q--;
+    return q;
+}
+
+bool TuningTable::fromScala(const char* scl, const char* kbm) {
+    char  line[96];
+    float cents[SCALA_MAX_NOTES + 1];
+    cents[0] = 0.0f;
+
+    // --- .scl: description, note count, pitches of degrees 1..N (degree N = period)
+    const char* p = scl;
+    if (!nextLine(p, line, sizeof(line))) return false;        // description (may be empty)
+    if (!nextLine(p, line, sizeof(line))) return false;
+    const int count = atoi(line);
+    if (count < 1 || count > SCALA_MAX_NOTES) {
+        ESP_LOGE(TAG, "scl: unsupported note count %d", count);
+        return false;
+    }
+    for (int i = 1; i <= count; ++i) {
+        if (!nextLine(p, line, sizeof(line)) || !parsePitch(line, cents[i])) {
+            ESP_LOGE(TAG, "scl: bad pitch line %d", i);
+            return false;
+        }
+    }
+
+    // --- .kbm (defaults: linear mapping, degree 0 on middle C at its 12-TET pitch)
+    int   mapSize = 0, first = 0, last = 127, middle = 60, refNote = 60, octDeg = count;
+    float refFreq = 261.625565f;
+    int   map[128];
+    if (kbm) {
+        int hdr[7];
+        float f = 0.0f;
+        const char* q = kbm;
+        for (int i = 0; i < 7; ++i) {
+            if (!nextLine(q, line, sizeof(line))) { ESP_LOGE(TAG, "kbm: short header"); return false; }
+            if (i == 5) f = strtof(line, nullptr); else hdr[i] = atoi(line);
+        }
+        mapSize = hdr[0]; first = hdr[1]; last = hdr[2]; middle = hdr[3]; refNote = hdr[4]; refFreq = f;
+        octDeg  = (hdr[6] > 0) ? hdr[6] : count;
+        if (mapSize < 0 || mapSize > 128 || refFreq <= 0.0f) { ESP_LOGE(TAG, "kbm: bad header"); return false; }
+        for (int i = 0; i < mapSize; ++i) {
+            // eksik satırlar: eşlenmemiş tuş
+            map[i] = (nextLine(q, line, sizeof(line)) && line[0] != 'x' && line[0] != 'X' && line[0]) ? atoi(line) : -1;
+        }
+    }
+
+    auto degreeOf = [&](int n, int& deg) -> bool {
+        if (mapSize == 0) { deg = n - middle; return true; }
+        const int off  = n - middle;
+        const int octs = floorDiv(off, mapSize);
+        const int m    = map[off - octs * mapSize];
+        if (m < 0) return false;
+        deg = m + octs * octDeg;
+        return true;
+    };
+    auto centsOf = [&](int deg) -> float {
+        const int per = floorDiv(deg, count);
+        return (float)per * cents[count] + cents[deg - per * count];
+    };
+
+    int refDeg;
+    if (!degreeOf(refNote, refDeg)) refDeg = refNote - middle;
+    const float refCents = centsOf(refDeg);
+    // 12-TET karşılaştırması: cent cinsinden, note 69 = 440 Hz
+    const float refOffset = 1200.0f * log2f(refFreq / 440.0f) - refCents;
+
+    float tmp[128];
+    for (int n = 0; n < 128; ++n) {
+        int deg;
+        tmp[n] = 1.0f;
+        if (n < first || n > last || !degreeOf(n, deg)) continue;
+        const float c = centsOf(deg) + refOffset - 100.0f * (float)(n - 69);
+        const float r = exp2f(c * (1.0f / 1200.0f));
+        if (r > 0.001f && r < 1000.0f) tmp[n] = r;
+    }
+    memcpy(dev, tmp, sizeof(dev));
+    ESP_LOGI(TAG, "Scala: %d notes, period %.2f cents%s", count, cents[count], kbm ? ", with keyboard mapping" : "");
+    return true;
+}
+
+#endif
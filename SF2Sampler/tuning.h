@@ -0,0 +1,104 @@
+/*
+ * ----------------------------------------------------------------------------
+ * ESP32-S3 SF2 Synthesizer Firmware
+ *
+ * Author: Evgeny Aslovskiy AKA Copych
+ * License: MIT
+ * Repository: https://github.com/copych/ESP32-S3_SF2_Sampler_Synthesizer
+ *
+ * File: tuning.h
+ * Purpose: contains 2 classes:
+ *          integer cents -> frequency ratio without exp2f (two small LUTs),
+ *          per-channel 128-key tuning table (MIDI Tuning Standard, Scala)
+ *
+ *  A voice's pitch is 12-TET note ratio × key deviation × channel shift:
+ *  the 12-TET part is an integer number of cents (key - root, sample pitch
+ *  correction, zone coarse/fine tune), read from the LUTs; the deviation of
+ *  each key from 12-TET is precomputed into the table whenever a tuning
+ *  arrives (SysEx, .scl/.kbm), so note-on never calls exp2f.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+#include "config.h"
+
+class CentsRatio {
+public:
+    // 2^(cents/1200): octave straight into the float exponent, semitone and cent steps from the LUTs
+    static inline float get(int cents) {
+        int oct = cents / 1200;
+        int rem = cents - oct * 1200;
+        if (rem < 0) { rem += 1200; oct--; }
+        if (oct < -126) oct = -126; else if (oct > 127) oct = 127;
+        const int semi = rem / 100;
+        union { uint32_t u; float f; } p2;
+        p2.u = (uint32_t)(oct + 127) << 23;
+        return p2.f * semiLut[semi] * centLut[rem - semi * 100];
+    }
+
+    static void ensureLUT() {
+        if (lutInitialized) return;
+        for (int i = 0; i < 12;  ++i) semiLut[i] = exp2f((float)i * (1.0f / 12.0f));
+        for (int i = 0; i < 100; ++i) centLut[i] = exp2f((float)i * (1.0f / 1200.0f));
+        lutInitialized = true;
+    }
+
+private:
+    static DRAM_ATTR float semiLut[12];
+    static DRAM_ATTR float centLut[100];
+    static bool lutInitialized;
+};
+
+inline DRAM_ATTR float CentsRatio::semiLut[12];
+inline DRAM_ATTR float CentsRatio::centLut[100];
+inline bool CentsRatio::lutInitialized = false;
+
+// ================================================================================================
+
+class TuningTable {
+public:
+    TuningTable() { resetNotes(); }
+
+    // Frequency ratio of this key against 12-TET, channel shift (XG note shift) included
+#ifdef ENABLE_MICROTUNING
+    inline float ratio(uint8_t note) const { return dev[note & 127] * shiftRatio; }
+#else
+    inline float ratio(uint8_t) const      { return shiftRatio; }
+#endif
+
+    inline void setShift(float semitones) { shiftRatio = exp2f(semitones * (1.0f / 12.0f)); }
+
+    inline void resetNotes() {
+#ifdef ENABLE_MICROTUNING
+        for (int n = 0; n < 128; ++n) dev[n] = 1.0f;
+#endif
+    }
+
+#ifdef ENABLE_MICROTUNING
+    // Absolute key pitch in cents above note 0 (MTS frequency data: semitone * 100 + fraction)
+    inline void setNoteCents(uint8_t note, float cents) {
+        note &= 127;
+        dev[note] = exp2f((cents - 100.0f * (float)note) * (1.0f / 1200.0f));
+    }
+
+    // MTS scale/octave tuning: offset in cents for every key of pitch class pc (0 = C)
+    inline void setPitchClassCents(int pc, float cents) {
+        const float r = exp2f(cents * (1.0f / 1200.0f));
+        for (int n = pc; n < 128; n += 12) dev[n] = r;
+    }
+
+    inline void copyNotes(const TuningTable& src) { memcpy(dev, src.dev, sizeof(dev)); }
+
+    // Scala scale (.scl text) with an optional keyboard mapping (.kbm text, nullptr = linear,
+    // degree 0 on note 60, 12-TET reference). Keys the mapping leaves out stay 12-TET.
+    bool fromScala(const char* scl, const char* kbm);
+#endif
+
+private:
+#ifdef ENABLE_MICROTUNING
+    float dev[128];
+#endif
+    float shiftRatio = 1.0f;
+};
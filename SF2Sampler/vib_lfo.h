@@ -0,0 +1,95 @@
+/*
+ * ----------------------------------------------------------------------------
+ * ESP32-S3 SF2 Synthesizer Firmware
+ *
+ * Author: Evgeny Aslovskiy AKA Copych
+ * License: MIT
+ * Repository: https://github.com/copych/ESP32-S3_SF2_Sampler_Synthesizer
+ *
+ * File: vib_lfo.h
+ * Purpose: per-channel bank of shared vibrato LFOs
+ *
+ *  Voices of one channel nearly always play zones with the same vibrato rate
+ *  and depth. Instead of every voice advancing its own phase and evaluating
+ *  sin + exp2, the channel keeps VIB_LFO_SLOTS running LFOs keyed by
+ *  (rate, depth); each is stepped once per audio block and stores the final
+ *  pitch ratio (mod wheel included). A voice only keeps its own delay counter
+ *  and then reads the ratio of its slot. Voices whose rate/depth finds neither
+ *  a matching nor a free slot fall back to their private LFO.
+ *  Shared phase: vibrato no longer restarts at 0 on each note-on (after the
+ *  voice's own delay it joins the running channel LFO).
+ *  Threads: tick() runs on the audio thread (renderLRBlock); slots are taken at
+ *  note-on (prepareStart) and freed by sweep() on the control thread once no
+ *  voice has held them for a whole pass. busy is the hand-off: acquire() fills
+ *  the slot before publishing it, tick() only touches published slots.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "misc.h"
+
+class VibLfoBank {
+public:
+    // Slot for this rate (phase increment per sample) and depth (cents), -1 = none left
+    inline int8_t acquire(float inc, float depth) {
+        int8_t freeK = -1;
+        for (int k = 0; k < VIB_LFO_SLOTS; ++k) {
+            Slot& s = slots[k];
+            if (s.busy) {
+                if (s.inc == inc && s.depth == depth) { s.held = 1; return (int8_t)k; }
+            } else if (freeK < 0) {
+                freeK = (int8_t)k;
+            }
+        }
+        if (freeK >= 0) {
+            Slot& s = slots[freeK];
+            s.inc   = inc;
+            s.depth = depth;
+            s.phase = 0.0f;
+            s.ratio = 1.0f;
+            s.held  = 1;
+            __atomic_store_n(&s.busy, (uint8_t)1, __ATOMIC_RELEASE);
+        }
+        return freeK;
+    }
+
+    inline void  hold(int8_t k)        { slots[k].held = 1; }
+    inline float ratio(int8_t k) const { return slots[k].ratio; }
+
+    // Control thread, once per pass before the voices hold their slots again
+    inline void sweep() {
+        for (int k = 0; k < VIB_LFO_SLOTS; ++k) {
+            Slot& s = slots[k];
+            if (!s.busy) continue;
+            if (!s.held) { __atomic_store_n(&s.busy, (uint8_t)0, __ATOMIC_RELAXED); continue; }     // hiçbir ses kalmadı
+            s.held = 0;
+        }
+    }
+
+    // Audio thread, once per block
+    inline void IRAM_ATTR tick(uint32_t samples, float modWheel) {
+        for (int k = 0; k < VIB_LFO_SLOTS; ++k) {
+            Slot& s = slots[k];
+            if (!__atomic_load_n(&s.busy, __ATOMIC_ACQUIRE)) continue;
+            s.phase += s.inc * (float)samples;
+            s.phase -= (float)(int)s.phase;
+            const float cents = sin_lut(s.phase) * modWheel * s.depth;
+            s.ratio = (cents != 0.0f) ? fastExp2(cents * DIV_1200) : 1.0f;
+        }
+    }
+
+    inline void clear() { memset(slots, 0, sizeof(slots)); }
+
+private:
+    struct Slot {
+        float   inc;        // per sample
+        float   depth;      // cents at full mod wheel
+        float   phase;
+        float   ratio;      // 2^(sin × modWheel × depth / 1200)
+        uint8_t busy;
+        uint8_t held;       // a voice used it since the last sweep
+    };
+    Slot slots[VIB_LFO_SLOTS] = {};
+};
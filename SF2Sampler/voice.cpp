@@ -28,6 +28,7 @@
 #include "voice.h"
 #include "misc.h"
 #include <math.h>
+#include <float.h>
 #include <esp_dsp.h>
 
 static const char* TAG = "Voice";
@@ -59,11 +60,27 @@ static FORCE_INLINE float velocityToGain(uint32_t velocity) {
 }
 
 void Voice::prepareStart(uint8_t ch, uint8_t note_, uint8_t vel, const Zone& z, ChannelState* chan) {
-    zone   = z;
+    VoiceCold& c = *cold;
+    c.zone = z;
+    const Zone& zone = c.zone;
     sample = zone.sample;
 
     // Parser sample->data'yı sample->start'a göre hizalı veriyor → ekstra offsetleme yok.
     data = reinterpret_cast<const int16_t*>(__builtin_assume_aligned(sample->data, 4));
+    dataR = zone.sampleR ? reinterpret_cast<const int16_t*>(__builtin_assume_aligned(zone.sampleR->data, 4)) : nullptr;
+    peak  = zone.sampleR ? fmaxf(sample->peak, zone.sampleR->peak) : sample->peak;
+#ifdef ENABLE_HOT_SAMPLES
+    // Atak kopyası: stereo çiftte iki kanal da iç RAM'deyse, kısa olanın boyu kadar
+    sample->plays = sample->plays + 1;     // packed SampleHeader: plain load/store, no reference
+    hot    = sample->hot;
+    hotR   = zone.sampleR ? zone.sampleR->hot : nullptr;
+    hotLen = hot ? sample->hotLen : 0;
+    if (zone.sampleR) {
+        zone.sampleR->plays = zone.sampleR->plays + 1;
+        if (!hotR) hotLen = 0;
+        else if (zone.sampleR->hotLen < hotLen) hotLen = zone.sampleR->hotLen;
+    }
+#endif
 
     const int startNote = chan->portaCurrentNote;
 
@@ -77,68 +94,90 @@ void Voice::prepareStart(uint8_t ch, uint8_t note_, uint8_t vel, const Zone& z,
 
     noteHeld    = true;
     samplesRun  = 0;
-    lastSamplesRun = 0;
+    c.lastSamplesRun = 0;
     exclusiveClass = zone.exclusiveClass;
 
     // Mod kaynak pointer'ları (hot-path'te kopya yok)
-    modWheel            = &chan->modWheel;
-    modVolume           = &chan->volume;
-    modExpression       = &chan->expression;
-    modPitchBendFactor  = &chan->pitchBendFactor;
-    modPan              = &chan->pan;
-    modSustain          = &chan->sustainPedal;
-    modPortaTime        = &chan->portaTime;
-    modPortamento       = &chan->portamento;
+    c.modWheel            = &chan->modWheel;
+    c.modVolume           = &chan->volume;
+    c.modExpression       = &chan->expression;
+    c.modPitchBendFactor  = &chan->pitchBendFactor;
+    c.modPan              = &chan->pan;
+    c.modBrightness       = &chan->brightness;
+    c.modSustain          = &chan->sustainPedal;
+    c.modPortaTime        = &chan->portaTime;
+    c.modPortamento       = &chan->portamento;
 
 #ifdef ENABLE_CH_FILTER_M
     chFilter.setCoeffs(&chan->filterCoeffs);
     chFilter.resetState();
+    chFilterR.setCoeffs(&chan->filterCoeffs);
+    chFilterR.resetState();
 #endif
 
-    velocityVolume = velocityToGain(velocity) * zone.attenuation;
+    c.velocityVolume = velocityToGain(velocity) * zone.attenuation;
+    // İki mono ses (L ve R ayrı pan) merkezde kanal başına 1 + 0.5 veriyordu; stereo ses
+    // tek pan (balance) ile 0.75 verir → aynı yükseklik için ×2
+    if (dataR) c.velocityVolume *= 2.0f;
 
-    // Statik mod-env pitch katkısı (başlangıçta)
-    const float modEnvStaticTune =
-        (zone.modAttackTime < 1.0f)
-            ? (1.0f - zone.modSustainLevel) * zone.modEnvToPitch * 0.01f
-            : 0.0f;
-
-    const int   rootKey   = (zone.rootKey >= 0) ? zone.rootKey : sample->originalPitch;
-    const float semi      = float(note_ - rootKey)
-                          + (sample->pitchCorrection * 0.01f)
-                          + zone.coarseTune + zone.fineTune
-                          + chan->tuningSemitones;
-    const float noteRatio = exp2f((modEnvStaticTune + semi) * DIV_12);
+    const float noteRatio = pitchRatio(note_, chan);
     const float baseStep  = float(sample->sampleRate) * DIV_SAMPLE_RATE;
-    basePhaseIncrement    = baseStep * noteRatio;   // pitch bend / LFO / porta ile güncellenecek
+    c.basePhaseIncrement  = baseStep * noteRatio;   // pitch bend / LFO / porta ile güncellenecek
 
     // Vibrato LFO
-    vibLfoPhase          = 0.0f;
-    vibLfoPhaseIncrement = zone.vibLfoFreq * DIV_SAMPLE_RATE;
-    vibLfoToPitch        = (zone.vibLfoToPitch == 0.0f) ? 50.0f : zone.vibLfoToPitch;
-    vibLfoDelaySamples   = zone.vibLfoDelay * SAMPLE_RATE;
-    vibLfoCounter        = 0;
-    vibLfoActive         = false;
-    pitchMod             = 1.0f;
+    c.vibLfoPhase          = 0.0f;
+    c.vibLfoPhaseIncrement = zone.vibLfoFreq * DIV_SAMPLE_RATE;
+    c.vibLfoToPitch        = (zone.vibLfoToPitch == 0.0f) ? 50.0f : zone.vibLfoToPitch;
+    c.vibLfoDelaySamples   = zone.vibLfoDelay * SAMPLE_RATE;
+    c.vibLfoCounter        = 0;
+    c.vibLfoActive         = false;
+    c.pitchMod             = 1.0f;
+#ifdef ENABLE_SHARED_VIB_LFO
+    c.vibBank              = &chan->vibLfo;
+    c.vibSlot              = chan->vibLfo.acquire(c.vibLfoPhaseIncrement, c.vibLfoToPitch);
+#endif
+
+    // Mod envelope + mod LFO: stepped once per block in updateModulators()
+    c.modActive = (zone.modEnvToPitch != 0.0f) || (zone.modEnvToFilterFc != 0.0f)
+               || (zone.modLfoToPitch != 0.0f) || (zone.modLfoToVolume != 0.0f)
+               || (zone.modLfoToFilterFc != 0.0f);
+    c.modEnv.setAttackTime  (zone.modAttackTime);
+    c.modEnv.setHoldTime    (zone.modHoldTime);
+    c.modEnv.setDecayTime   (zone.modDecayTime);
+    c.modEnv.setSustainLevel(1.0f - zone.modSustainLevel);
+    c.modEnv.setReleaseTime (zone.modReleaseTime);
+    c.modLfoPhase          = 0.0f;
+    c.modLfoPhaseIncrement = ((zone.modLfoFreq > 0.0f) ? zone.modLfoFreq : 8.176f) * DMA_BUFFER_LEN * DIV_SAMPLE_RATE; // SF2 default: 0 cents = 8.176 Hz
+    c.modLfoDelayBlocks    = zone.modLfoDelay * BLOCK_RATE;
+    c.modLfoCounter        = 0;
+    c.modPitchFactor       = 1.0f;
+    c.modGain              = 1.0f;
 
     // Portamento (log-domain step tanımı)
-    portamentoActive = (modPortamento && *modPortamento);
-    if (portamentoActive) {
-        const float noteDiff     = float(note_ - startNote);
-        const float freqRatio    = exp2f(noteDiff * DIV_12);
-        const float timeSec      = 0.01f + (*modPortaTime) * 0.5f;
+    c.portamentoActive = (c.modPortamento && *c.modPortamento);
+    if (c.portamentoActive) {
+        const float freqRatio    = CentsRatio::get(100 * (note_ - startNote))
+                                 * chan->tuning.ratio(note_) / chan->tuning.ratio(startNote);
+        const float timeSec      = 0.01f + (*c.modPortaTime) * 0.5f;
         const float totalSamples = fmaxf(1.0f, timeSec * SAMPLE_RATE);
 
-        portamentoLogDelta   = exp2f(log2f(freqRatio) / totalSamples);   // örnek başına çarpan tabanı
-        portamentoFactor     = 1.0f / freqRatio;                         // önceki sesten başla
+        c.portamentoLogDelta = exp2f(log2f(freqRatio) / totalSamples);   // örnek başına çarpan tabanı
+        c.portamentoFactor   = 1.0f / freqRatio;                         // önceki sesten başla
     } else {
-        portamentoLogDelta = 1.0f;
-        portamentoFactor   = 1.0f;
+        c.portamentoLogDelta = 1.0f;
+        c.portamentoFactor   = 1.0f;
     }
 
     updatePitch();
     updatePan();
 
+    // Çıkış kazancı: ilk blok rampasız başlar, sonra blok başına hedefe yürür
+    const float g = c.velocityVolume * (*c.modVolume) * (*c.modExpression);
+    gainL     = g * c.panL;
+    gainR     = g * c.panR;
+    gainStepL = 0.0f;
+    gainStepR = 0.0f;
+
     reverbAmount = zone.reverbSend * chan->reverbSend;
     chorusAmount = zone.chorusSend * chan->chorusSend;
 
@@ -162,40 +201,64 @@ void Voice::prepareStart(uint8_t ch, uint8_t note_, uint8_t vel, const Zone& z,
     }
 
 #ifdef ENABLE_IN_VOICE_FILTERS
-    filterCutoff    = fclamp(zone.filterFc, 10.0f, 20000.0f);
-    filterResonance = (zone.filterQ <= 0.0f) ? 0.707f : 1.0f / powf(10.0f, zone.filterQ / 20.0f);
+    const float filterCutoff    = fclamp(zone.filterFc, 10.0f, 20000.0f);
+    const float filterResonance = (zone.filterQ <= 0.0f) ? 0.707f : 0.707f * powf(10.0f, zone.filterQ / 20.0f); // dB of resonance over Butterworth
+    FilterCalc::ensureLUT();
+
+    // Sabit ve tamamen açık zone filtresi renderer'da atlanır: karar zone'un kendi kesimi ve
+    // modülasyon yönlendirmesiyle verilir. Velocity ofseti sadece zone'un kendi filtresi olan
+    // seslere uygulanır; açık zone'da CC74 kesimi düşürürse updateModulators filtreyi açar.
+    c.filterOpen = (filterResonance <= 0.7072f)
+                && (zone.modEnvToFilterFc == 0.0f) && (zone.modLfoToFilterFc == 0.0f)
+                && (filterCutoff >= VOICE_FILTER_BYPASS_HZ);
+    c.filterFreqPos  = FilterCalc::freqToLutPos(filterCutoff);
+    if (!c.filterOpen) c.filterFreqPos += (1.0f - velocity * DIV_127) * VOICE_FILTER_VEL_CENTS * FilterCalc::LutPosPerCent;
+    c.filterQPos     = FilterCalc::qToLutPos(filterResonance);
+    c.filterModCents = *c.modBrightness;
     filter.resetState();
-    filter.setFreqAndQ(filterCutoff, filterResonance);
+    filter.setLutPos(c.filterFreqPos + c.filterModCents * FilterCalc::LutPosPerCent, c.filterQPos);
+    filterOn = !(c.filterOpen && c.filterModCents >= 0.0f);
 #endif
 
     envLast = 0.0f; // skor için cache
+    level       = 0.0f;
+    quietBlocks = 0;
+    virt        = false;
+}
+
+// Zone kökü + sample pitch düzeltmesi + coarse/fine tune: hepsi tam sayı cent (SF2 jeneratörleri),
+// LUT'tan okunur; kanal tuning tablosu (MTS / Scala, XG note shift) tuşun 12-TET'ten sapmasını verir
+float Voice::pitchRatio(uint8_t key, const ChannelState* chan) const {
+    const Zone& zone   = cold->zone;
+    const int  rootKey = (zone.rootKey >= 0) ? zone.rootKey : sample->originalPitch;
+    const int  cents   = 100 * (key - rootKey) + sample->pitchCorrection
+                       + (int)lrintf((zone.coarseTune + zone.fineTune) * 100.0f);
+    return CentsRatio::get(cents) * chan->tuning.ratio(key);
 }
 
 void Voice::startNew(uint8_t ch, uint8_t note_, uint8_t vel, const Zone& z, ChannelState* chan) {
     prepareStart(ch, note_, vel, z, chan);
     ampEnv.retrigger(Adsr::END_NOW);
+    cold->modEnv.retrigger(Adsr::END_NOW);
     active = true;
 }
 
 void Voice::updatePitchOnly(uint8_t newNote, ChannelState* chan) {
-    const int   rootKey   = (zone.rootKey >= 0) ? zone.rootKey : sample->originalPitch;
-    const float semi      = float(newNote - rootKey)
-                          + (sample->pitchCorrection * 0.01f)
-                          + zone.coarseTune + zone.fineTune;
-    const float noteRatio = exp2f(semi * DIV_12);
-    basePhaseIncrement    = float(sample->sampleRate) * DIV_SAMPLE_RATE * noteRatio;
-
-    portamentoActive = (modPortamento && *modPortamento);
-    if (portamentoActive) {
-        const float noteDiff     = float(newNote - chan->portaCurrentNote);
-        const float freqRatio    = exp2f(noteDiff * DIV_12);
-        const float timeSec      = 0.01f + (*modPortaTime) * 0.5f;
+    VoiceCold& c = *cold;
+    const float noteRatio = pitchRatio(newNote, chan);
+    c.basePhaseIncrement  = float(sample->sampleRate) * DIV_SAMPLE_RATE * noteRatio;
+
+    c.portamentoActive = (c.modPortamento && *c.modPortamento);
+    if (c.portamentoActive) {
+        const float freqRatio    = CentsRatio::get(100 * (newNote - chan->portaCurrentNote))
+                                 * chan->tuning.ratio(newNote) / chan->tuning.ratio(chan->portaCurrentNote);
+        const float timeSec      = 0.01f + (*c.modPortaTime) * 0.5f;
         const float totalSamples = fmaxf(1.0f, timeSec * SAMPLE_RATE);
-        portamentoLogDelta       = exp2f(log2f(freqRatio) / totalSamples);
+        c.portamentoLogDelta     = exp2f(log2f(freqRatio) / totalSamples);
         // portamentoFactor ses iş parçacığında 1.0'a yürüyecek
     } else {
-        portamentoFactor   = 1.0f;
-        portamentoLogDelta = 1.0f;
+        c.portamentoFactor   = 1.0f;
+        c.portamentoLogDelta = 1.0f;
     }
 
     note = newNote;
@@ -203,14 +266,16 @@ void Voice::updatePitchOnly(uint8_t newNote, ChannelState* chan) {
 }
 
 void Voice::stop() {
-    if (!(modSustain && *modSustain)) {
+    if (!(cold->modSustain && *cold->modSustain)) {
         noteHeld = false;
         ampEnv.end(Adsr::END_REGULAR);
+        cold->modEnv.end(Adsr::END_REGULAR);
     }
 }
 
 void Voice::kill() {
     ampEnv.end(Adsr::END_NOW);
+    cold->modEnv.end(Adsr::END_NOW);
     noteHeld = false;
     active = false;
 }
@@ -218,176 +283,373 @@ void Voice::kill() {
 void Voice::die() {
     noteHeld = false;
     ampEnv.end(Adsr::END_FAST);
+    cold->modEnv.end(Adsr::END_FAST);
+}
+
+void Voice::choke() {
+    if (ampEnv.getCurrentSegment() >= Adsr::ADSR_SEG_SEMI_FAST_RELEASE) return;   // zaten hızlı sönüyor
+    noteHeld = false;
+    ampEnv.end(Adsr::END_SEMI_FAST);
+    cold->modEnv.end(Adsr::END_SEMI_FAST);
 }
 
 bool Voice::isRunning() const {
     return ampEnv.isRunning();
 }
 
-// ---- HOT PATH: tek örnek üretimi ----
-float HOT IRAM_ATTR Voice::nextSample() {
-    if (UNLIKELY(!sample)) {
-        active = false;
-        return 0.0f;
-    }
-
-    // Bu örnek sabit increment ile üretilecek
-    //updatePitch();
+// ---- HOT PATH: blok renderer ailesi ----
+// Her (döngü, ses filtresi, kanal filtresi, stereo) birleşimi için ayrı bir örnekleme:
+// örnek döngüsünde dallanma yok, kapalı filtre hiç çağrılmaz. Blok başında selectRenderer()
+// tablodan seçer. Çıkış: env uygulanmış, kazançsız örnekler; dönen değer üretilen örnek
+// sayısı (sample sonu: ses pasifleşir, kalan örnekler sessiz).
+// Ping-pong (loopType 4) SF2'de yok (sampleModes & 3): sadece skipBlock() tanır.
+template <bool Looping, bool VF, bool CF, bool Stereo>
+int HOT IRAM_ATTR Voice::renderBlockT(Voice& v, const float* __restrict env,
+                                      float* __restrict outL, float* __restrict outR,
+                                      const int16_t* __restrict src, const int16_t* __restrict srcR) {
+    float          phase  = v.phase;
+    float          inc    = v.effectivePhaseIncrement;
+    const float    step   = v.phaseIncrementStep;
+    const uint32_t length = v.length;
+    const float    loopEnd    = (float)v.loopEnd;
+    const float    loopLength = (float)v.loopLength;
+    const bool     draft  = draftQuality;
+
+    int i = 0;
+    for (; i < DMA_BUFFER_LEN; ++i) {
+        const uint32_t idx = (uint32_t)phase;
+        if (UNLIKELY(idx >= length)) {      // emniyet
+            v.active = false;
+            break;
+        }
 
-    // Örneği ürettikten sonra zaman tabanını ilerleteceğiz (aşağıda)
-    // -> jitter/metalik bozulmayı önler
+        float interp, interpR = 0.0f;
+        if (UNLIKELY(draft)) {
+            interp = (float)src[idx];       // aşırı yükte: tek okuma, enterpolasyon yok
+            if (Stereo) interpR = (float)srcR[idx];
+        } else {
+            const float frac = phase - (float)idx;
+            const uint32_t i0 = (idx > 0u) ? (idx - 1u) : 0u;
+
+            const float s0 = (float)src[i0];
+            const float s1 = (float)src[idx];
+            interp = s0 + (s1 - s0) * frac;
+            if (Stereo) {
+                const float r0 = (float)srcR[i0];
+                const float r1 = (float)srcR[idx];
+                interpR = r0 + (r1 - r0) * frac;
+            }
+        }
 
-    // Örnek alma + lineer enterpolasyon (güvenli)
-    const uint32_t idx  = (uint32_t)phase;
-    if (UNLIKELY(idx >= (uint32_t)length)) {   // emniyet
-        active = false;
-        return 0.0f;
-    }
+        // velocity/tremolo/CC7/CC11/pan: blok rampası olarak renderer'da (gainL/gainR)
+        float val  = interp  * ONE_DIV_32768 * env[i];
+        float valR = interpR * ONE_DIV_32768 * env[i];
 
-    const float frac = phase - (float)idx;
-    const uint32_t i0 = (idx > 0u) ? (idx - 1u) : 0u;
+#ifdef ENABLE_IN_VOICE_FILTERS
+        if (VF) {
+            if (Stereo) v.filter.processLR(&val, &valR);
+            else        val = v.filter.process(val);
+        }
+#endif
+#ifdef ENABLE_CH_FILTER_M
+        if (CF) {
+            val = v.chFilter.process(val);
+            if (Stereo) valR = v.chFilterR.process(valR);
+        }
+#endif
 
-    const float s0 = (float)data[i0];
-    const float s1 = (float)data[idx];
-    const float interp = s0 + (s1 - s0) * frac;
-    const float smp    = interp * ONE_DIV_32768;
+        // Faz/döngü
+        phase += inc;
+        if (Looping) {
+            if (UNLIKELY(phase >= loopEnd)) phase -= loopLength;
+        } else if (UNLIKELY(phase >= length)) {
+            v.active = false;
+            break;
+        }
 
-    // Envelope sadece audio thread'de ilerler
-    const float env = ampEnv.process();
-    envLast         = env;
+        outL[i] = val;
+        if (Stereo) outR[i] = valR;
 
-    float val = smp * velocityVolume * env * (*modVolume) * (*modExpression);
+        // Blok içi lineer rampalar (updateModulators hedefleri)
+        inc += step;
 
-#ifdef ENABLE_IN_VOICE_FILTERS
-    val = filter.process(val);
+#if PITCH_FACTORS_PER_SAMPLE
+        v.samplesRun++;
+        v.updatePitchFactors();   // vibrato/porta ilerlemesi burada → stabil ses
 #endif
-#ifdef ENABLE_CH_FILTER_M
-    val = chFilter.process(val);
+    }
+
+    v.phase = phase;
+    v.effectivePhaseIncrement = inc;
+#if !PITCH_FACTORS_PER_SAMPLE
+    v.samplesRun += i;
 #endif
+    return i;
+}
+
+#define VOICE_RENDERERS(CF, ST) \
+    &Voice::renderBlockT<false, false, CF, ST>, &Voice::renderBlockT<true, false, CF, ST>, \
+    &Voice::renderBlockT<false, true,  CF, ST>, &Voice::renderBlockT<true, true,  CF, ST>
+
+// İndeks: bit0 döngü, bit1 ses filtresi, bit2 kanal filtresi, bit3 stereo
+const Voice::BlockRenderer Voice::renderers[16] = {
+    VOICE_RENDERERS(false, false), VOICE_RENDERERS(true, false),
+    VOICE_RENDERERS(false, true),  VOICE_RENDERERS(true, true)
+};
+
+#undef VOICE_RENDERERS
+
+Voice::BlockRenderer Voice::selectRenderer() {
+    // Sustain döngüsü: nota bırakıldıysa döngüden çık, sample sonuna kadar çal
+    if (loopType == SUSTAIN_LOOP && !noteHeld) loopType = NO_LOOP;
+    const bool looping = (loopType == FORWARD_LOOP) || (loopType == SUSTAIN_LOOP);
+
+    return renderers[(looping ? 1 : 0) | (filterOn ? 2 : 0) | (chFilterOn ? 4 : 0) | (dataR ? 8 : 0)];
+}
+
+#if defined(ENABLE_SAMPLE_PREFETCH) || defined(ENABLE_HOT_SAMPLES)
+// ---- Bu bloğun okuyabileceği örnek aralığı [lo, hi] (prefetch ve atak kopyası için) ----
+// Faz artışı blok içinde lineer rampalı: son faz = p + N·inc + step·N(N-1)/2.
+bool HOT IRAM_ATTR Voice::readSpan(uint32_t& lo, uint32_t& hi) const {
+    if (UNLIKELY(!sample || length == 0)) return false;
+
+    const float n    = (float)DMA_BUFFER_LEN;
+    const float pEnd = phase + n * effectivePhaseIncrement + phaseIncrementStep * (n * (n - 1.0f) * 0.5f);
+    if (UNLIKELY(!(pEnd >= phase))) return false;
+
+    // Örnek başına toplamanın yuvarlama payı (büyük fazlarda ulp > 0) + i0/idx komşuluğu
+    const uint32_t margin = 2u + (uint32_t)(pEnd * (n * FLT_EPSILON));
+    const uint32_t idx0   = (uint32_t)phase;
+    lo = (idx0 > 0u) ? idx0 - 1u : 0u;
+    hi = (uint32_t)pEnd + margin;
+    const uint32_t wrapLo = (loopStart > 0u) ? loopStart - 1u : 0u;   // sarmadan sonraki ilk i0
 
-    // Faz/döngü
     switch (loopType) {
         case FORWARD_LOOP:
-            phase += effectivePhaseIncrement;
-            if (UNLIKELY(phase >= loopEnd)) phase -= loopLength;
+            // Döngüye sarıyorsa: loopStart-1 .. loopEnd arası (kısa döngüde birden çok tur dahil).
+            // Artış döngü boyunu aşarsa faz döngüden kaçabilir: o zaman doğrusal üst sınır kalır.
+            if (hi >= loopEnd) {
+                const float incMax = fmaxf(effectivePhaseIncrement, effectivePhaseIncrement + phaseIncrementStep * (n - 1.0f));
+                if (phase < (float)loopEnd && incMax < (float)loopLength) hi = loopEnd;
+                if (wrapLo < lo) lo = wrapLo;
+            }
+            break;
+        case SUSTAIN_LOOP:
+            // noteHeld blok ortasında (kontrol çekirdeğinden) değişebilir: sarma + doğrusal yolun ikisi
+            if (hi >= loopEnd && wrapLo < lo) lo = wrapLo;
             break;
+        default:
+            break;
+    }
+    if (hi > length - 1u) hi = length - 1u;
+    return lo <= hi;
+}
+#endif
+
+#ifdef ENABLE_SAMPLE_PREFETCH
+// ---- PSRAM → DRAM: bu bloğun okuyacağı örnek aralığını önceden kopyala ----
+// Pencere kaydırılmış pointer ile verilir (src[idx] == data[idx]), renderer indeksleri değişmez.
+// Aralık cap'e sığmazsa false: src'ler olduğu gibi kalır, PSRAM'den doğrudan okunur.
+bool HOT IRAM_ATTR Voice::prefetchBlock(int16_t* buf, uint32_t cap, const int16_t*& srcL, const int16_t*& srcR) const {
+    uint32_t lo, hi;
+    if (!readSpan(lo, hi)) return false;
+
+    const uint32_t count = hi - lo + 1u;
+    if (count > cap) return false;
+
+    memcpy(buf, data + lo, count * sizeof(int16_t));
+    srcL = buf - lo;
+    if (dataR) {
+        memcpy(buf + cap, dataR + lo, count * sizeof(int16_t));
+        srcR = buf + cap - lo;
+    }
+    return true;
+}
+#endif
+
+#ifdef ENABLE_HOT_SAMPLES
+// Blok sadece atak kopyasının içinden okuyorsa PSRAM yerine iç RAM; sınırı aşan blok PSRAM'den
+bool HOT IRAM_ATTR Voice::hotBlock(const int16_t*& srcL, const int16_t*& srcR) const {
+    if (hotLen == 0 || phase + 2.0f >= (float)hotLen) return false;     // atak geride kaldı
+    uint32_t lo, hi;
+    if (!readSpan(lo, hi) || hi >= hotLen) return false;
+    srcL = hot;
+    if (dataR) srcR = hotR;
+    return true;
+}
+#endif
+
+// ---- Sanal ses: bir blokluk zamanı örnek okumadan ilerlet ----
+// Faz artışı blok içinde lineer rampalı: Σ(inc + k·step), k = 0..N-1
+void HOT IRAM_ATTR Voice::skipBlock() {
+    if (UNLIKELY(!sample)) {
+        active = false;
+        return;
+    }
+
+    const float n   = (float)DMA_BUFFER_LEN;
+    const float adv = effectivePhaseIncrement * n + phaseIncrementStep * (n * (n - 1.0f) * 0.5f);
+    effectivePhaseIncrement += phaseIncrementStep * n;
+    samplesRun += DMA_BUFFER_LEN;
 
+    const float lStart = (float)loopStart;
+    const float lLen   = (float)loopLength;
+
+    switch (loopType) {
         case SUSTAIN_LOOP:
-            phase += effectivePhaseIncrement;
-            if (noteHeld) {
-                if (UNLIKELY(phase >= loopEnd)) phase -= loopLength;
-            } else {
+            if (!noteHeld) {
                 loopType = NO_LOOP;
-                if (UNLIKELY(phase >= length)) { active = false; return 0.0f; }
+                phase += adv;
+                if (phase >= length) active = false;
+                break;
             }
+            [[fallthrough]];   // döngü tutuluyor
+        case FORWARD_LOOP:
+            phase += adv;
+            if (phase >= loopEnd && lLen > 0.0f) phase = lStart + fmodf(phase - lStart, lLen);
             break;
 
         case PING_PONG_LOOP:
-            if (forward) {
-                phase += effectivePhaseIncrement;
-                if (UNLIKELY(phase >= loopEnd)) {
-                    phase   = 2.0f * loopEnd - phase;
-                    forward = false;
-                }
+            if (forward && (phase + adv < loopEnd || lLen <= 0.0f)) {
+                phase += adv;
             } else {
-                phase -= effectivePhaseIncrement;
-                if (UNLIKELY(phase <= loopStart)) {
-                    phase   = 2.0f * loopStart - phase;
-                    forward = true;
-                }
+                // açılmış (unfolded) konum, periyot 2·L
+                float u = forward ? (phase - lStart) : (2.0f * lLen - (phase - lStart));
+                u = fmodf(u + adv, 2.0f * lLen);
+                if (u < lLen) { phase = lStart + u;                forward = true;  }
+                else          { phase = lStart + (2.0f * lLen - u); forward = false; }
             }
             break;
 
         case NO_LOOP:
         default:
-            phase += effectivePhaseIncrement;
-            if (UNLIKELY(phase >= length)) { active = false; return 0.0f; }
+            phase += adv;
+            if (phase >= length) active = false;
             break;
     }
-
-    if (UNLIKELY(ampEnv.isIdle())) {
-        active = false;
-        return 0.0f;
-    }
-
-    // Zaman sayaçları: SONDA (bir sonraki örnek için)
-    samplesRun++;
-#if PITCH_FACTORS_PER_SAMPLE
-    updatePitchFactors();   // vibrato/porta ilerlemesi burada → stabil ses
-#endif
-
-    return val;
-}
-
-void Voice::renderBlock(float* block) {
-    for (uint32_t i = 0; i < DMA_BUFFER_LEN; ++i) {
-        block[i] = nextSample();
-    }
 }
 
-// RT dışı: skor (envelope ilerletmez)
-void Voice::updateScore() {
-    if (UNLIKELY(!active || !sample)) {
-        score = 0.0f;
-        return;
-    }
-
-    float env = ampEnv.process();
-    score = env * velocityVolume;
-
-    if (!isRunning() || ampEnv.isIdle()) {
-        score *= 0.1f;
-    }
+void Voice::wake() {
+    // Eski filtre durumu artık örnek akışına uymuyor: sıfırdan başla. Kazanç rampası
+    // duyulmaz seviyeden başladığı için geçiş örtülür.
+#ifdef ENABLE_IN_VOICE_FILTERS
+    filter.resetState();
+    filter.setLutPos(cold->filterFreqPos + cold->filterModCents * FilterCalc::LutPosPerCent, cold->filterQPos);
+#endif
+#ifdef ENABLE_CH_FILTER_M
+    chFilter.resetState();
+    chFilterR.resetState();
+#endif
+    virt = false;
 }
 
 void __attribute__((always_inline))  Voice::updatePitchFactors() {
     // not clean if cross-threaded, but it's granular anyway ;-)
-    float deltaSamplesRun = samplesRun - lastSamplesRun;
-    lastSamplesRun = samplesRun;
+    VoiceCold& c = *cold;
+    float deltaSamplesRun = samplesRun - c.lastSamplesRun;
+    c.lastSamplesRun = samplesRun;
 
     // Vibrato LFO
-    if (!vibLfoActive) {
-        vibLfoCounter += deltaSamplesRun;
-        if (vibLfoCounter >= vibLfoDelaySamples)
-            vibLfoActive = true;
-        pitchMod = 1.0f;
+#ifdef ENABLE_SHARED_VIB_LFO
+    if (c.vibSlot >= 0) c.vibBank->hold(c.vibSlot);     // gecikmede de slotu tut
+#endif
+    if (!c.vibLfoActive) {
+        c.vibLfoCounter += deltaSamplesRun;
+        if (c.vibLfoCounter >= c.vibLfoDelaySamples)
+            c.vibLfoActive = true;
+        c.pitchMod = 1.0f;
+#ifdef ENABLE_SHARED_VIB_LFO
+    } else if (c.vibSlot >= 0) {
+        c.pitchMod = c.vibBank->ratio(c.vibSlot);      // kanal LFO'su: sin/exp2 zaten hesaplı
+#endif
     } else {
-        vibLfoPhase += vibLfoPhaseIncrement * deltaSamplesRun;
-        if (vibLfoPhase >= 1.0f) vibLfoPhase -= 1.0f;
+        c.vibLfoPhase += c.vibLfoPhaseIncrement * deltaSamplesRun;
+        if (c.vibLfoPhase >= 1.0f) c.vibLfoPhase -= 1.0f;
 
-        float lfo = sin_lut(vibLfoPhase);
-        float cents = lfo * (*modWheel) * vibLfoToPitch;
-        pitchMod = fastExp2(cents * (1.0f * DIV_1200));
+        float lfo = sin_lut(c.vibLfoPhase);
+        float cents = lfo * (*c.modWheel) * c.vibLfoToPitch;
+        c.pitchMod = fastExp2(cents * (1.0f * DIV_1200));
     }
 
     // Portamento 
-    if (portamentoActive) {
-        portamentoFactor *= powf(portamentoLogDelta, deltaSamplesRun);
-        currentPhaseIncrement = basePhaseIncrement * portamentoFactor;
+    if (c.portamentoActive) {
+        c.portamentoFactor *= powf(c.portamentoLogDelta, deltaSamplesRun);
 
         // Stop when close enough
-        if ( (portamentoLogDelta >= 1.0f && portamentoFactor >= 1.0f) ||
-            (portamentoLogDelta <= 1.0f && portamentoFactor <= 1.0f) ) {
-            portamentoFactor = 1.0f;
-            portamentoActive = false;
-            currentPhaseIncrement = targetPhaseIncrement;
+        if ( (c.portamentoLogDelta >= 1.0f && c.portamentoFactor >= 1.0f) ||
+            (c.portamentoLogDelta <= 1.0f && c.portamentoFactor <= 1.0f) ) {
+            c.portamentoFactor = 1.0f;
+            c.portamentoActive = false;
         }
         
     }
+}
+
+// Audio thread, once per block: mod envelope + mod LFO (+ CC74) → pitch, volume and cutoff.
+// Pitch and output gains are turned into per-sample linear ramps that land exactly on
+// the block-end value, so the hot loop only adds a step per sample.
+void HOT IRAM_ATTR Voice::updateModulators() {
+    VoiceCold& c = *cold;
+    const Zone& zone = c.zone;
+    float menv = 0.0f;
+    float mlfo = 0.0f;
+
+    if (c.modActive) {
+        menv = c.modEnv.process();  // Adsr inited with DMA_BUFFER_LEN: one step per block
+
+        if (c.modLfoCounter < c.modLfoDelayBlocks) {
+            c.modLfoCounter++;
+        } else {
+            c.modLfoPhase += c.modLfoPhaseIncrement;
+            if (c.modLfoPhase >= 1.0f) c.modLfoPhase -= 1.0f;
+            // SF2 LFO: triangle, starts at 0 going up
+            const float p = c.modLfoPhase;
+            mlfo = (p < 0.25f) ? 4.0f * p : (p < 0.75f) ? 2.0f - 4.0f * p : 4.0f * p - 4.0f;
+        }
+
+        const float pitchCents = menv * zone.modEnvToPitch + mlfo * zone.modLfoToPitch;
+        c.modPitchFactor = (pitchCents != 0.0f) ? fastExp2(pitchCents * DIV_1200) : 1.0f;
+
+        // centibels → gain: 10^(-cB/200) = 2^(-cB * log2(10)/200)
+        c.modGain = (zone.modLfoToVolume != 0.0f)
+                  ? fastExp2(-mlfo * zone.modLfoToVolume * 0.016609640f)
+                  : 1.0f;
+    }
+
+#ifdef ENABLE_IN_VOICE_FILTERS
+    // Cutoff: CC74 + mod env + mod LFO, in cents → LUT position (no logf/expf here).
+    // Coefficients glide across the block instead of jumping.
+    float fcCents = *c.modBrightness;
+    if (c.modActive) fcCents += menv * zone.modEnvToFilterFc + mlfo * zone.modLfoToFilterFc;
+    const bool on = !(c.filterOpen && fcCents >= 0.0f);
+    if (on && !filterOn) {
+        // Atlanan filtre devreye giriyor: eski durum geçersiz, hedefe doğrudan otur
+        c.filterModCents = fcCents;
+        filter.resetState();
+        filter.setLutPos(c.filterFreqPos + fcCents * FilterCalc::LutPosPerCent, c.filterQPos);
+    } else if (fcCents != c.filterModCents) {
+        c.filterModCents = fcCents;
+        if (on) filter.rampToLutPos(c.filterFreqPos + fcCents * FilterCalc::LutPosPerCent, c.filterQPos, DMA_BUFFER_LEN);
+    }
+    filterOn = on;
+#endif
 
-    // Mod LFO 
-    // modFactor = ...
+    phaseIncrementStep = (calcPhaseIncrement() - effectivePhaseIncrement) * DIV_BLOCK_LEN;
+    setGainTargets();
 }
 
 
 void Voice::init() {
     active         = false;
-    panL           = 1.0f;
-    panR           = 1.0f;
-    velocityVolume = 1.0f;
+    cold->panL     = 1.0f;
+    cold->panR     = 1.0f;
+    cold->velocityVolume = 1.0f;
     sample         = nullptr;
     envLast        = 0.0f;
     ampEnv.init(SAMPLE_RATE);
+    cold->modEnv.init(SAMPLE_RATE, DMA_BUFFER_LEN);
+    ampEnv.setSemiFastReleaseTime(EXCLUSIVE_CHOKE_MS * 0.001f);
+    cold->modEnv.setSemiFastReleaseTime(EXCLUSIVE_CHOKE_MS * 0.001f);
     id = usage;
     usage++;
     ESP_LOGD(TAG, "id=%d sr=%d", id, SAMPLE_RATE);
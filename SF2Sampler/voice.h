@@ -30,6 +30,7 @@
 #include "SF2Parser.h"
 #include "adsr.h"
 #include "biquad2.h"
+#include "svf.h"
 
 enum LoopType {
     NO_LOOP = 0,
@@ -39,28 +40,15 @@ enum LoopType {
     PING_PONG_LOOP = 4 // never used
 };
 
-struct Voice {
-    float   phase = 0.0f; 
-    float   velocityVolume = 1.0f;
-    float   panL = 1.0f, panR = 1.0f;
-    float   score = 0.0f;
-    float   reverbAmount = 0.0f;
-    float   chorusAmount = 0.0f;
-    float   expression = 0.0f;
-    float   volume = 1.0f;
-    uint32_t exclusiveClass = 0;
-    size_t  samplesRun = 0;
-    size_t  lastSamplesRun = 0;
-
-#ifdef ENABLE_IN_VOICE_FILTERS
-    BiquadFilterInternalCoeffs filter;
-    float filterCutoff = 20000.0f;
-    float filterResonance = 0.0f;
-#endif
-
-#ifdef ENABLE_CH_FILTER_M
-    BiquadFilterSharedCoeffs chFilter;
-#endif
+// ================================================================================================
+// Soğuk kısım: nota başlangıcı + blok hızında modülasyon durumu.
+// prepareStart / updateModulators / updatePitchFactors kullanır (blokta en fazla bir kez),
+// örnek döngüsü hiç dokunmaz. Synth::voiceCold[] içinde, ses slotu başına bir tane.
+struct VoiceCold {
+    Zone     zone = {};
+    float    velocityVolume = 1.0f;
+    float    panL = 1.0f, panR = 1.0f;
+    size_t   lastSamplesRun = 0;
 
     // Channel mod kaynakları
     float*     modWheel = nullptr;
@@ -68,61 +56,107 @@ struct Voice {
     float*     modExpression = nullptr;
     float*     modPitchBendFactor = nullptr;
     float*     modPan = nullptr;
+    float*     modBrightness = nullptr;
     float*     modPortaTime = nullptr;
     uint32_t*  modPortamento = nullptr;
     uint32_t*  modSustain = nullptr;
-    uint32_t   noteHeld = false;
-    
-    float modFactor = 1.0f;
-    float vibFactor = 1.0f;
-    float pitchMod  = 1.0f;
 
-    // LFO state
+    // Modulation envelope + mod LFO (control rate: evaluated once per block)
+    Adsr     modEnv;
+    bool     modActive            = false;  // zone routes mod env / mod LFO somewhere
+    float    modLfoPhase          = 0.0f;
+    float    modLfoPhaseIncrement = 0.0f;   // per block
+    uint32_t modLfoCounter        = 0;
+    uint32_t modLfoDelayBlocks    = 0;
+    float    modPitchFactor       = 1.0f;   // mod env + mod LFO pitch ratio
+    float    modGain              = 1.0f;   // mod LFO tremolo (block target)
+
+    // Vibrato LFO
     float    vibLfoPhase = 0.0f;
     float    vibLfoPhaseIncrement = 0.0f;
     uint32_t vibLfoCounter = 0;
     uint32_t vibLfoDelaySamples = 0;
     bool     vibLfoActive = false;
     float    vibLfoToPitch = 50.0f;
+    float    pitchMod  = 1.0f;
+#ifdef ENABLE_SHARED_VIB_LFO
+    VibLfoBank* vibBank = nullptr;          // channel LFO bank
+    int8_t      vibSlot = -1;               // shared LFO in vibBank, -1 = private LFO above
+#endif
 
-    // Pitch/step
-    float basePhaseIncrement      = 1.0f;   // from note + tuning
-    float targetPhaseIncrement    = 0.0f;   // pitch bend hedefi
-    float currentPhaseIncrement   = 0.0f;   // anlık (geçişte)
-    float effectivePhaseIncrement = 0.0f;   // render’da kullanılan
-    float portamentoLogDelta      = 0.0f;   // (eski; kalabilir)
-    float div_basePhaseIncrement  = 0.0f;
+    // Pitch
+    float    basePhaseIncrement = 1.0f;     // from note + tuning
 
     // Portamento
-    float     portamentoFactor         = 1.0f;   // anlık çarpan
-    float     targetPortamentoFactor   = 1.0f;
-    float     portamentoRate           = 0.0005f;
-    float     portamentoTime           = 0.0f;   // sec
-    float     portamentoSpeed          = 0.0f;
-    uint32_t  portamentoActive         = false;
-    float     portaLog2PerSample       = 0.0f;   // <<< YENİ: log2(freqRatio)/totalSamples
-
-    // Sample/loop
+    float    portamentoFactor   = 1.0f;     // anlık çarpan
+    float    portamentoLogDelta = 1.0f;     // örnek başına çarpan tabanı
+    uint32_t portamentoActive   = false;
+
+#ifdef ENABLE_IN_VOICE_FILTERS
+    float filterFreqPos  = 0.0f;    // FilterCalc LUT position: zone cutoff (+ velocity unless filterOpen)
+    float filterQPos     = 0.0f;
+    float filterModCents = 0.0f;    // modulation applied on the last block
+    bool  filterOpen     = false;   // zone cutoff >= VOICE_FILTER_BYPASS_HZ, no resonance, no modulation routed
+#endif
+};
+
+// ================================================================================================
+// Sıcak kısım: Synth::voices[] dizisi. Örnek başına okunan her şey baştadır (erişim sırasıyla),
+// ardından blok hızında renderer/skor/allocator alanları. Soğuk veri sadece `cold` üzerinden.
+struct alignas(32) Voice {
+    // ---- Per-sample: renderSample() + mixVoice() ----
+    float     phase = 0.0f;
+    float     effectivePhaseIncrement = 0.0f;   // render’da kullanılan
+    float     phaseIncrementStep      = 0.0f;   // blok içi lineer rampa
+    const int16_t* data  = nullptr;             // sample->start hizalı
+    const int16_t* dataR = nullptr;             // linked stereo çiftinin sağ kanalı (aynı faz), mono seste nullptr
     uint32_t  length     = 0;
     uint32_t  loopStart  = 0;
     uint32_t  loopEnd    = 0;
     uint32_t  loopLength = 0;
-    uint32_t  active     = false; 
-    uint32_t  forward    = true; // ping-pong
     LoopType  loopType   = NO_LOOP;
-    SampleHeader* sample = nullptr;
-    Zone       zone = {};
+    uint32_t  forward    = true; // ping-pong
+    uint32_t  noteHeld   = false;
+    uint32_t  active     = false;
+    size_t    samplesRun = 0;
 
-    const int16_t* data = nullptr; // <<< YENİ: const
+    float     gainL = 0.0f, gainR = 0.0f;            // velocity × tremolo × CC7 × CC11 × pan
+    float     gainStepL = 0.0f, gainStepR = 0.0f;    // applied by the block renderer
+    float     reverbAmount = 0.0f;
+    float     chorusAmount = 0.0f;
 
-    Adsr     ampEnv;
+    Adsr      ampEnv;
 
+#ifdef ENABLE_IN_VOICE_FILTERS
+    VoiceFilter filter;
+#endif
+#ifdef ENABLE_CH_FILTER_M
+    SharedCoeffsFilter chFilter;
+    SharedCoeffsFilter chFilterR;   // linked stereo: sağ kanal durumu (katsayılar ortak)
+#endif
+    bool      filterOn   = false;   // ses filtresi çalışıyor (tamamen açıksa renderer atlar)
+    bool      chFilterOn = false;   // kanal filtresi çalışıyor
+
+    // ---- Block rate: renderer, score snapshot, allocator ----
+    SampleHeader* sample = nullptr;
+    float    peak    = 0.0f;  // sample peak (stereo: iki kanalın büyüğü)
+    float    envLast = 0.0f;  // blok sonu envelope (audio thread yazar, skor yayını için)
+    float    level   = 0.0f;  // blok sonu çıkış seviyesi tahmini: env × gain × sample peak × scaler
+    uint16_t quietBlocks = 0;
+#ifdef ENABLE_HOT_SAMPLES
+    const int16_t* hot  = nullptr;  // iç RAM atak kopyaları (sample->hot), ilk hotLen örnek
+    const int16_t* hotR = nullptr;
+    uint32_t hotLen  = 0;           // 0: kopya yok (stereo: iki kanalın ortak uzunluğu)
+#endif
+    bool     virt    = false; // sanal ses: faz/envelope ilerler, render edilmez (skipBlock)
+    bool     fadeOut = false; // ghost slot: bu blokta sıfıra söner (Synth::ghosts); cold'a dokunmaz
     uint32_t note = 0;
     uint32_t velocity = 0;
     uint32_t channel = 0;
+    uint32_t exclusiveClass = 0;
+    int      id = 0;
 
-    // Envelope cache (control tarafında skor için)
-    float envLast = 0.0f; // <<< YENİ
+    VoiceCold* cold = nullptr;    // Synth::voiceCold[i], init()'ten önce bağlanır
 
     // API
     void prepareStart(uint8_t ch, uint8_t note_, uint8_t vel, const Zone& z, ChannelState* chan);
@@ -132,36 +166,83 @@ struct Voice {
     void stop();
     void kill();
     void die();
+    void choke();               // exclusive class cut: EXCLUSIVE_CHOKE_MS release
     bool  isRunning() const;
-    float nextSample();
-    void  renderBlock(float* block);
+    // Block renderer: env = ampEnv.processBlock() output, src = data/dataR (or their prefetched
+    // windows). Writes env-scaled, pre-gain samples and returns how many were produced.
+    using BlockRenderer = int (*)(Voice& v, const float* env, float* outL, float* outR,
+                                  const int16_t* srcL, const int16_t* srcR);
+    BlockRenderer selectRenderer();             // by loop mode, filter states and stereo; once per block
+    inline void setChannelFilter(bool on) {     // channel filter wide open → skipped
+#ifdef ENABLE_CH_FILTER_M
+        if (on && !chFilterOn) {                // eski durum geçersiz: temiz başla
+            chFilter.resetState();
+            chFilterR.resetState();
+        }
+        chFilterOn = on;
+#endif
+    }
+#if defined(ENABLE_SAMPLE_PREFETCH) || defined(ENABLE_HOT_SAMPLES)
+    bool  readSpan(uint32_t& lo, uint32_t& hi) const;     // sample indices this block can read
+#endif
+#ifdef ENABLE_SAMPLE_PREFETCH
+    bool  prefetchBlock(int16_t* buf, uint32_t cap, const int16_t*& srcL, const int16_t*& srcR) const;
+#endif
+#ifdef ENABLE_HOT_SAMPLES
+    bool  hotBlock(const int16_t*& srcL, const int16_t*& srcR) const;   // block within the internal RAM attack copy
+#endif
+    void  skipBlock();             // virtual voice: advance phase/loops over one block without reading samples
+    void  wake();                  // back from virtual: restart filters from a clean state
     void  init();
     static int usage; // = 0
-    int   id = 0;
+    static inline bool draftQuality = false;   // governor: nearest-sample playback (no interpolation)
 
-    void updateScore();
-    void updatePortamento();
     void updatePitchOnly(uint8_t newNote, ChannelState* chan);
+    float pitchRatio(uint8_t key, const ChannelState* chan) const;    // zone + channel tuning, no exp2f
 
     inline __attribute__((always_inline)) void updatePan() {
-        float pZone = zone.pan;
-        float pMod  = modPan ? (*modPan * 2.0f - 1.0f) : 0.0f;
+        VoiceCold& c = *cold;
+        float pZone = c.zone.pan;
+        float pMod  = c.modPan ? (*c.modPan * 2.0f - 1.0f) : 0.0f;
 
         float p = fclamp(pZone + pMod, -1.0f, 1.0f);  // [-1,1]
         p = 0.5f * (p + 1.0f);                        // [0,1]
 
         // Equal-power panning yerine basit linear panning
-        panL = 1.0f - p * 0.5f;
-        panR = 0.5f + p * 0.5f;
+        c.panL = 1.0f - p * 0.5f;
+        c.panR = 0.5f + p * 0.5f;
     }
 
     void updatePitchFactors();
+    void updateModulators();
+    template <bool Looping, bool VF, bool CF, bool Stereo>
+    static int renderBlockT(Voice& v, const float* env, float* outL, float* outR,
+                            const int16_t* srcL, const int16_t* srcR);
+    static const BlockRenderer renderers[16];
+
+    inline void __attribute__((always_inline)) setGainTargets() {
+        updatePan();
+        const VoiceCold& c = *cold;
+        const float g = c.velocityVolume * c.modGain * (*c.modVolume) * (*c.modExpression);
+        gainStepL = (g * c.panL - gainL) * DIV_BLOCK_LEN;
+        gainStepR = (g * c.panR - gainR) * DIV_BLOCK_LEN;
+    }
+
+    inline float __attribute__((always_inline)) calcPhaseIncrement() const {
+        const VoiceCold& c = *cold;
+        return c.basePhaseIncrement * (*c.modPitchBendFactor) * c.portamentoFactor * c.pitchMod * c.modPitchFactor;
+    }
 
     inline void __attribute__((always_inline)) updatePitch() {
-        effectivePhaseIncrement = basePhaseIncrement * (*modPitchBendFactor) * portamentoFactor * pitchMod;
+        effectivePhaseIncrement = calcPhaseIncrement();
+        phaseIncrementStep      = 0.0f;
     }
     
-    void setPortamentoTarget(float targetNoteRatio);
     void printState();
-    bool isLegato = false;
 };
+// Yerleşim bütçesi (ESP32-S3, varsayılan config, 32-byte satırlar):
+//   Voice 416 B = 13 satır: 0..79 örnek başı skalerler, 80 ampEnv (92 B), 172 filter (88 B),
+//   260/296 chFilter/chFilterR (36 B), 336.. blok hızı alanları; VoiceCold 392 B (Zone 152 B).
+// 64-bit host derlemesi 448 B (8 baytlık pointer'lar). Synth::begin() gerçek değerleri loglar.
+static_assert(sizeof(Voice) <= 14 * 32, "Voice hot record grew past 14 cache lines: move block-rate data to VoiceCold");
+static_assert(offsetof(Voice, ampEnv) <= 3 * 32, "per-sample scalars no longer fit the first three cache lines");
@@ -0,0 +1,253 @@
+/*
+ * ----------------------------------------------------------------------------
+ * ESP32-S3 SF2 Synthesizer Firmware
+ *
+ * Author: Evgeny Aslovskiy AKA Copych
+ * License: MIT
+ * Repository: https://github.com/copych/ESP32-S3_SF2_Sampler_Synthesizer
+ *
+ * File: voice_alloc.h
+ * Purpose: contains 2 classes + stealing policy selection:
+ *          per-block voice score snapshot (audio thread -> control thread, lock-free),
+ *          min-heap voice allocator working on that snapshot
+ *
+ *  The audio thread is the only one that touches envelopes. Once per block it
+ *  publishes a read-only picture of every voice (level, age, release state,
+ *  channel/note). The control thread never calls into a running voice to rank
+ *  it: note-on takes the latest snapshot, heapifies it once (O(n)) and then
+ *  pops victims in O(log n). Voices handed out since the snapshot are marked
+ *  as taken, so a chord never steals its own fresh notes.
+ *  Per channel, a polyphony cap makes a channel steal from itself once it is
+ *  full, and reserved voices are kept away from the other channels: free
+ *  voices are not handed out below the unmet reservations, and a channel at
+ *  or under its reservation is not stolen from while other victims exist.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+#include <Arduino.h>
+#include <string.h>
+#include "config.h"
+
+enum StealPolicy : uint8_t {
+    STEAL_QUIETEST,         // lowest potential output level
+    STEAL_OLDEST,           // longest running voice
+    STEAL_RELEASE_FIRST,    // released voices first (quietest of them), then the quietest held one
+    STEAL_SAME_NOTE         // a voice already playing this channel/note, else release-first
+};
+
+struct VoiceScore {
+    float    level;         // potential output level: env (or 1 while rising) × gain × sample peak
+    uint32_t age;           // samples rendered since start
+    uint8_t  channel;
+    uint8_t  note;
+    uint8_t  active;
+    uint8_t  releasing;
+};
+
+// ================================================================================================
+// Single writer (audio thread, once per block), single reader (control thread).
+// Two buffers + sequence counter: the writer fills the back buffer and bumps the counter,
+// the reader copies the front buffer and retries if the counter moved meanwhile.
+
+template <int N>
+class ScoreSnapshot {
+public:
+    ScoreSnapshot() { memset(buf, 0, sizeof(buf)); }   // all voices inactive
+
+    inline VoiceScore* beginWrite() { return buf[(seq + 1) & 1]; }
+    inline void endWrite() {
+        __sync_synchronize();
+        seq = seq + 1;
+    }
+
+    inline uint32_t sequence() const { return seq; }
+
+    uint32_t read(VoiceScore* out) const {
+        uint32_t s;
+        do {
+            s = seq;
+            __sync_synchronize();
+            memcpy(out, buf[s & 1], sizeof(VoiceScore) * N);
+            __sync_synchronize();
+        } while (s != seq);
+        return s;
+    }
+
+private:
+    VoiceScore buf[2][N];
+    volatile uint32_t seq = 0;
+};
+
+// ================================================================================================
+
+template <int N>
+class VoiceAllocator {
+    static_assert(N > 0 && N <= 255, "voice index must fit uint8_t");
+
+public:
+    void setPolicy(StealPolicy p) { policy = p; seq = ~0u; }
+    StealPolicy getPolicy() const { return policy; }
+
+    // maxVoices = 0: no cap. Takes effect with the next snapshot.
+    void setChannelLimits(uint8_t ch, uint8_t maxVoices, uint8_t reserved) {
+        chMax[ch & 15]     = maxVoices;
+        chReserve[ch & 15] = reserved;
+        seq = ~0u;
+    }
+
+    // Pick up a newer snapshot (if any) and rebuild the free list + victim heap
+    void sync(const ScoreSnapshot<N>& snap) {
+        if (snap.sequence() == seq) return;
+        seq = snap.read(s);
+        rebuild();
+    }
+
+    // Returns the voice index to (re)start for channel/note, or -1 when every slot this note
+    // may have was already handed out in this block (more note-ons than voices: drop the note).
+    // allowFree = false: polyphony is capped, a sounding voice must be stolen.
+    int allocate(uint8_t ch, uint8_t note, bool allowFree = true) {
+        // Per-note cap (and same-note policy): reuse the quietest voice on this note
+        int sameNote = -1, count = 0;
+        for (int i = 0; i < N; ++i) {
+            if (taken[i] || !s[i].active || s[i].channel != ch || s[i].note != note) continue;
+            count++;
+            if (sameNote < 0 || s[i].level < s[sameNote].level) sameNote = i;
+        }
+        if (sameNote >= 0 && (count >= MAX_VOICES_PER_NOTE || policy == STEAL_SAME_NOTE)) {
+            return take(sameNote, ch);
+        }
+
+        // Channel cap reached: steal within the channel, never from the global pool. If every
+        // voice of the channel was handed out in this block, the earliest of them is restarted
+        // (chCount >= chMax >= 1, so the channel always owns a slot here).
+        if (chMax[ch] && chCount[ch] >= chMax[ch]) {
+            int best = -1, first = -1;
+            for (int i = 0; i < N; ++i) {
+                if (owner[i] != ch) continue;
+                if (taken[i]) {
+                    if (first < 0 || takenSeq[i] < takenSeq[first]) first = i;
+                } else if (best < 0 || keys[i] < keys[best]) {
+                    best = i;
+                }
+            }
+            return take(best >= 0 ? best : first, ch);
+        }
+
+        while (allowFree && nFree > 0 && nFree > unmetReserve(ch)) {
+            const int i = freeList[--nFree];
+            if (!taken[i]) return take(i, ch);
+        }
+
+        while (nHeap > 0) {
+            const int i = pop();
+            if (taken[i]) continue;
+            if (isReserved(i, ch)) { deferred[nDeferred++] = (uint8_t)i; continue; }
+            return take(i, ch);
+        }
+
+        // Only reserved voices are left: the quietest of them
+        while (nDeferredUsed < nDeferred) {
+            const int i = deferred[nDeferredUsed++];
+            if (!taken[i]) return take(i, ch);
+        }
+
+        // More note-ons than voices within one block: every sounding voice is taken, what is
+        // left is free voices kept for other channels' reservations (or held back by allowFree)
+        return -1;
+    }
+
+private:
+    inline int take(int i, uint8_t ch) {
+        if (owner[i] != NoOwner) chCount[owner[i]]--;
+        owner[i] = ch & 15;
+        chCount[ch & 15]++;
+        taken[i] = 1;
+        takenSeq[i] = ++nTaken;
+        return i;
+    }
+
+    // Voices other channels still need to reach their reservations
+    inline int unmetReserve(uint8_t ch) const {
+        int n = 0;
+        for (int c = 0; c < 16; ++c)
+            if (c != ch && chCount[c] < chReserve[c]) n += chReserve[c] - chCount[c];
+        return n;
+    }
+
+    // Stealing slot i would take its channel below its reservation
+    inline bool isReserved(int i, uint8_t ch) const {
+        const uint8_t o = owner[i];
+        return o != NoOwner && o != ch && chCount[o] <= chReserve[o];
+    }
+
+    inline float key(const VoiceScore& v) const {
+        switch (policy) {
+            case STEAL_OLDEST:        return -(float)v.age;
+            case STEAL_QUIETEST:      return v.level;
+            case STEAL_SAME_NOTE:
+            case STEAL_RELEASE_FIRST:
+            default:                  return v.releasing ? v.level : v.level + 1000.0f;
+        }
+    }
+
+    void rebuild() {
+        nFree = nHeap = nDeferred = nDeferredUsed = nTaken = 0;
+        memset(chCount, 0, sizeof(chCount));
+        for (int i = N - 1; i >= 0; --i) {       // lowest index is handed out first
+            taken[i] = 0;
+            if (!s[i].active) {
+                owner[i] = NoOwner;
+                freeList[nFree++] = (uint8_t)i;
+            } else {
+                owner[i] = s[i].channel & 15;
+                chCount[owner[i]]++;
+                keys[i] = key(s[i]);
+                heap[nHeap++] = (uint8_t)i;
+            }
+        }
+        for (int j = nHeap / 2 - 1; j >= 0; --j) siftDown(j);
+    }
+
+    void siftDown(int j) {
+        const uint8_t item = heap[j];
+        const float   k    = keys[item];
+        for (;;) {
+            int c = 2 * j + 1;
+            if (c >= nHeap) break;
+            if (c + 1 < nHeap && keys[heap[c + 1]] < keys[heap[c]]) c++;
+            if (!(keys[heap[c]] < k)) break;
+            heap[j] = heap[c];
+            j = c;
+        }
+        heap[j] = item;
+    }
+
+    int pop() {
+        const int top = heap[0];
+        heap[0] = heap[--nHeap];
+        if (nHeap > 0) siftDown(0);
+        return top;
+    }
+
+    static constexpr uint8_t NoOwner = 0xFF;
+
+    StealPolicy policy = VOICE_STEAL_POLICY;
+    uint32_t    seq    = ~0u;
+    VoiceScore  s[N] = {};
+    float       keys[N] = {};
+    uint8_t     heap[N] = {};
+    uint8_t     freeList[N] = {};
+    uint8_t     taken[N] = {};
+    uint16_t    takenSeq[N] = {};       // order of the hand-outs since the snapshot (cap fallback)
+    uint8_t     owner[N] = {};          // channel of the slot incl. this block's note-ons, NoOwner = free
+    uint8_t     deferred[N] = {};       // popped victims protected by their channel's reservation
+    uint8_t     chCount[16] = {};       // voices per channel (snapshot + handed out since)
+    uint8_t     chMax[16] = {};         // per-channel polyphony cap, 0 = none
+    uint8_t     chReserve[16] = {};     // voices other channels may not take
+    int         nHeap = 0;
+    int         nFree = 0;
+    int         nDeferred = 0;
+    int         nDeferredUsed = 0;
+    uint16_t    nTaken = 0;
+};
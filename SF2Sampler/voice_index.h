@@ -0,0 +1,127 @@
+/*
+ * ----------------------------------------------------------------------------
+ * ESP32-S3 SF2 Synthesizer Firmware
+ *
+ * Author: Evgeny Aslovskiy AKA Copych
+ * License: MIT
+ * Repository: https://github.com/copych/ESP32-S3_SF2_Sampler_Synthesizer
+ *
+ * File: voice_index.h
+ * Purpose: per-channel, per-(channel, note) and per-(channel, exclusive class)
+ *          voice slot bitmasks
+ *
+ *  Note-off, CC fan-out and channel-wide operations visit only the slots whose
+ *  bit is set instead of scanning every voice. Only the control thread writes
+ *  the masks: a slot is added when a note starts on it and removed when the
+ *  control thread kills or re-uses it. Voices that the audio thread retires
+ *  (envelope end, sample end, governor) keep their bit until the next visit,
+ *  where the caller sees !active and drops it (see Synth::forVoices).
+ *  (channel, note) = noteMask[note] & chanMask[channel], 1 KB for 128 notes.
+ *  Exclusive classes (SF2 gen 57, hi-hat / cuica chokes) get a small table per
+ *  channel: CHOKE_CLASSES_PER_CH entries of (class, slots). Classes that do
+ *  not fit go to a per-channel overflow mask, which callers filter by class.
+ *  Up to 64 slots (one uint64_t per mask, config.h stops larger MAX_VOICES);
+ *  the allocator itself (voice_alloc.h) is benchmarked up to 128.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+template <int N>
+class VoiceIndex {
+    static_assert(N > 0 && N <= 64, "voice slots must fit a 64-bit mask");
+
+public:
+    using Mask = uint64_t;
+
+    static inline Mask bit(int i) { return (Mask)1 << i; }
+
+    inline void add(int i, uint8_t ch, uint8_t note, uint16_t cls = 0) {
+        remove(i);
+        slotCh[i]   = ch & 15;
+        slotNote[i] = note & 127;
+        slotCls[i]  = cls;
+        chanMask[slotCh[i]]   |= bit(i);
+        noteMask[slotNote[i]] |= bit(i);
+        if (cls) addClass(i, slotCh[i], cls);
+        listed[i] = 1;
+    }
+
+    inline void remove(int i) {
+        if (!listed[i]) return;
+        chanMask[slotCh[i]]   &= ~bit(i);
+        noteMask[slotNote[i]] &= ~bit(i);
+        if (slotCls[i]) removeClass(i, slotCh[i], slotCls[i]);
+        listed[i] = 0;
+    }
+
+    // Legato: the slot keeps sounding on another note
+    inline void moveNote(int i, uint8_t note) {
+        if (!listed[i]) return;
+        noteMask[slotNote[i]] &= ~bit(i);
+        slotNote[i] = note & 127;
+        noteMask[slotNote[i]] |= bit(i);
+    }
+
+    inline Mask channel(uint8_t ch) const             { return chanMask[ch & 15]; }
+    inline Mask note(uint8_t ch, uint8_t note) const  { return chanMask[ch & 15] & noteMask[note & 127]; }
+
+    // Slots of this exclusive class on the channel (+ overflow slots: check the class)
+    inline Mask exclusive(uint8_t ch, uint16_t cls) const {
+        const ClassSlot* t = choke[ch & 15];
+        for (int k = 0; k < CHOKE_CLASSES_PER_CH; ++k)
+            if (t[k].cls == cls) return t[k].slots | chokeOverflow[ch & 15];
+        return chokeOverflow[ch & 15];
+    }
+
+    inline void clear() {
+        memset(chanMask, 0, sizeof(chanMask));
+        memset(noteMask, 0, sizeof(noteMask));
+        memset(choke,    0, sizeof(choke));
+        memset(chokeOverflow, 0, sizeof(chokeOverflow));
+        memset(listed,   0, sizeof(listed));
+    }
+
+private:
+    struct ClassSlot {
+        Mask     slots;
+        uint16_t cls;       // 0 = boş
+    };
+
+    inline void addClass(int i, uint8_t ch, uint16_t cls) {
+        ClassSlot* t = choke[ch];
+        int freeK = -1;
+        for (int k = 0; k < CHOKE_CLASSES_PER_CH; ++k) {
+            if (t[k].cls == cls) { t[k].slots |= bit(i); return; }
+            if (t[k].cls == 0 && freeK < 0) freeK = k;
+        }
+        if (freeK >= 0) {
+            t[freeK].cls   = cls;
+            t[freeK].slots = bit(i);
+        } else {
+            chokeOverflow[ch] |= bit(i);
+        }
+    }
+
+    inline void removeClass(int i, uint8_t ch, uint16_t cls) {
+        chokeOverflow[ch] &= ~bit(i);
+        ClassSlot* t = choke[ch];
+        for (int k = 0; k < CHOKE_CLASSES_PER_CH; ++k) {
+            if (t[k].cls != cls) continue;
+            t[k].slots &= ~bit(i);
+            if (!t[k].slots) t[k].cls = 0;      // girişi serbest bırak
+            return;
+        }
+    }
+
+    Mask      chanMask[16]  = {};
+    Mask      noteMask[128] = {};
+    ClassSlot choke[16][CHOKE_CLASSES_PER_CH] = {};
+    Mask      chokeOverflow[16] = {};
+    uint16_t  slotCls[N]    = {};
+    uint8_t   slotCh[N]     = {};
+    uint8_t   slotNote[N]   = {};
+    uint8_t   listed[N]     = {};
+};
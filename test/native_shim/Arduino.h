@@ -0,0 +1,42 @@
+/*
+ * Host stand-in for the few Arduino / ESP-IDF names the tested modules use
+ * (pio test -e native). Not a port: only what adsr.cpp, fx_convolver.cpp and
+ * voice_alloc.h need to compile and run on the PC.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <thread>
+#include <chrono>
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#define ESP_LOGE(tag, ...) ((void)(tag))
+#define ESP_LOGW(tag, ...) ((void)(tag))
+#define ESP_LOGI(tag, ...) ((void)(tag))
+#define ESP_LOGD(tag, ...) ((void)(tag))
+
+#define MALLOC_CAP_INTERNAL 1
+#define MALLOC_CAP_SPIRAM   2
+
+inline void* heap_caps_malloc(size_t n, uint32_t)                     { return malloc(n); }
+inline void* heap_caps_aligned_alloc(size_t a, size_t n, uint32_t)   { return aligned_alloc(a, (n + a - 1) / a * a); }
+inline void  heap_caps_free(void* p)                                  { free(p); }
+
+inline void vTaskDelay(uint32_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+class String {
+public:
+    String(const char* c = "") : s(c ? c : "") {}
+    String& operator+=(const char* c) { s += c; return *this; }
+    String& operator+=(char c)        { s += c; return *this; }
+    const char* c_str() const         { return s.c_str(); }
+private:
+    std::string s;
+};
@@ -0,0 +1,16 @@
+/*
+ * Host stand-in for SdFat: no card, every open() fails.
+ */
+
+#pragma once
+#include <Arduino.h>
+
+#define O_RDONLY 0
+
+class FsFile {
+public:
+    bool open(const char*, int = O_RDONLY)  { return false; }
+    int  read(void*, size_t)                { return 0; }
+    bool seekCur(int32_t)                   { return false; }
+    void close()                            {}
+};
@@ -0,0 +1,87 @@
+/*
+ * Adsr on the host: block renderer vs per-sample steps, and the retrigger()/end()
+ * hand-off with a block rendered on another thread.
+ * pio test -e native -f test_adsr
+ */
+
+#include <unity.h>
+#include <thread>
+#include <vector>
+#include "adsr.h"
+
+static void setupEnv(Adsr& e) {
+    e.init(44100.0f);
+    e.setAttackTime(0.003f, 0.0f);
+    e.setHoldTime(0.002f);
+    e.setDecayTime(0.05f);
+    e.setSustainLevel(0.4f);
+    e.setReleaseTime(0.02f);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// attack, hold, decay, sustain, release into idle: blocks of 128 give the same
+// values as one-sample steps
+void test_block_equals_steps() {
+    static Adsr a, b;
+    setupEnv(a);
+    setupEnv(b);
+    a.retrigger(Adsr::END_NOW);
+    b.retrigger(Adsr::END_NOW);
+
+    const int blocks = 200;
+    std::vector<float> ref(blocks * 128), blk(blocks * 128);
+    for (int k = 0; k < blocks; ++k) {
+        if (k == 120) { a.end(Adsr::END_REGULAR); b.end(Adsr::END_REGULAR); }
+        for (int i = 0; i < 128; ++i) ref[k * 128 + i] = a.process();
+        b.processBlock(&blk[k * 128], 128);
+    }
+    for (size_t i = 0; i < ref.size(); ++i) TEST_ASSERT_EQUAL_FLOAT(ref[i], blk[i]);
+    TEST_ASSERT_TRUE(b.isIdle());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, b.getVal());
+}
+
+// an event between two blocks is what the next block renders from
+void test_event_between_blocks() {
+    static Adsr e;
+    setupEnv(e);
+    float out[128];
+    e.retrigger(Adsr::END_NOW);
+    for (int k = 0; k < 50; ++k) e.processBlock(out, 128);
+    const float held = e.getVal();
+    TEST_ASSERT_TRUE(held > 0.0f && !e.isReleasing());
+    e.end(Adsr::END_FAST);
+    TEST_ASSERT_TRUE(e.isReleasing());
+    e.processBlock(out, 128);
+    TEST_ASSERT_TRUE(out[0] < held);
+    TEST_ASSERT_TRUE(e.isIdle());
+}
+
+// end() from another thread while a long block renders: whatever the timing, the
+// event wins and the block never writes its older state back over it
+void test_event_during_block_wins() {
+    static Adsr e;
+    static std::vector<float> out(1 << 16);
+    for (int r = 0; r < 300; ++r) {
+        setupEnv(e);
+        e.retrigger(Adsr::END_NOW);
+        std::thread audio([] { e.processBlock(out.data(), (int)out.size()); });
+        e.end((r & 1) ? Adsr::END_NOW : Adsr::END_REGULAR);
+        audio.join();
+        if (r & 1) {
+            TEST_ASSERT_TRUE(e.isIdle());
+            TEST_ASSERT_EQUAL_FLOAT(0.0f, e.getVal());
+        } else {
+            TEST_ASSERT_TRUE(e.isReleasing() || e.isIdle());
+        }
+    }
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_block_equals_steps);
+    RUN_TEST(test_event_between_blocks);
+    RUN_TEST(test_event_during_block_wins);
+    return UNITY_END();
+}
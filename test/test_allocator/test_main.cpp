@@ -0,0 +1,211 @@
+/*
+ * VoiceAllocator on the host: free list, victim order, per-channel cap and reservations,
+ * and the cost of sync() + allocate() with 64 and 128 voices.
+ * pio test -e native -f test_allocator
+ */
+
+#include <unity.h>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include "voice_alloc.h"
+
+constexpr int N = 8;
+
+static ScoreSnapshot<N>  snap;
+static VoiceAllocator<N> alloc;
+static VoiceScore        st[N];
+
+static void publish() {
+    memcpy(snap.beginWrite(), st, sizeof(st));
+    snap.endWrite();
+}
+
+static void voice(int i, uint8_t ch, uint8_t note, float level, bool releasing = false) {
+    st[i] = { level, 1000u, ch, note, 1, (uint8_t)releasing };
+}
+
+void setUp() {
+    memset(st, 0, sizeof(st));
+    alloc = VoiceAllocator<N>();
+    alloc.setPolicy(STEAL_QUIETEST);
+}
+
+void tearDown() {}
+
+// Empty snapshot: slots are handed out from the lowest index, never twice
+void test_free_voices_first() {
+    publish();
+    alloc.sync(snap);
+    for (int k = 0; k < N; ++k) TEST_ASSERT_EQUAL_INT(k, alloc.allocate(0, 60 + k));
+}
+
+// All voices sound: the quietest is stolen first, then the next quietest
+void test_steals_quietest() {
+    const float lv[N] = { 0.9f, 0.5f, 0.1f, 0.7f, 0.3f, 0.8f, 0.6f, 0.4f };
+    for (int i = 0; i < N; ++i) voice(i, 1, 40 + i, lv[i]);
+    publish();
+    alloc.sync(snap);
+    TEST_ASSERT_EQUAL_INT(2, alloc.allocate(0, 60));
+    TEST_ASSERT_EQUAL_INT(4, alloc.allocate(0, 61));
+    TEST_ASSERT_EQUAL_INT(7, alloc.allocate(0, 62));
+}
+
+// Cap 2 with both voices sounding: five note-ons stay on the channel's own two slots,
+// although free voices and quieter voices of other channels exist
+void test_cap_steals_within_channel() {
+    voice(0, 3, 60, 0.5f);
+    voice(1, 3, 61, 0.4f);
+    voice(2, 5, 30, 0.01f);
+    publish();
+    alloc.setChannelLimits(3, 2, 0);
+    alloc.sync(snap);
+    TEST_ASSERT_EQUAL_INT(1, alloc.allocate(3, 70));     // quieter of the two first
+    TEST_ASSERT_EQUAL_INT(0, alloc.allocate(3, 71));
+    for (int k = 2; k < 5; ++k) {
+        const int i = alloc.allocate(3, 70 + k);
+        TEST_ASSERT_TRUE(i == 0 || i == 1);
+    }
+}
+
+// Cap reached by this block's own note-ons: the earliest of them is restarted
+void test_cap_restarts_earliest_hand_out() {
+    publish();
+    alloc.setChannelLimits(3, 2, 0);
+    alloc.sync(snap);
+    const int a = alloc.allocate(3, 60);
+    const int b = alloc.allocate(3, 61);
+    TEST_ASSERT_NOT_EQUAL(a, b);
+    TEST_ASSERT_EQUAL_INT(a, alloc.allocate(3, 62));
+    TEST_ASSERT_EQUAL_INT(b, alloc.allocate(3, 63));
+    TEST_ASSERT_EQUAL_INT(a, alloc.allocate(3, 64));
+}
+
+// Two voices reserved for channel 9: a busy channel 0 does not take the last free ones
+void test_reserve_keeps_free_voices() {
+    publish();
+    alloc.setChannelLimits(9, 0, 2);
+    alloc.sync(snap);
+    bool used[N] = {};
+    for (int k = 0; k < N - 2; ++k) used[alloc.allocate(0, 40 + k)] = true;
+    TEST_ASSERT_EQUAL_INT(-1, alloc.allocate(0, 50));   // the last two are channel 9's
+    const int d1 = alloc.allocate(9, 36);
+    const int d2 = alloc.allocate(9, 38);
+    TEST_ASSERT_NOT_EQUAL(d1, d2);
+    TEST_ASSERT_FALSE(used[d1]);
+    TEST_ASSERT_FALSE(used[d2]);
+}
+
+// A channel at its reservation is not stolen from while other victims exist
+void test_reserve_protects_sounding_voices() {
+    for (int i = 0; i < N; ++i) voice(i, 1, 40 + i, 0.5f);
+    voice(3, 9, 36, 0.01f);
+    voice(6, 9, 38, 0.02f);
+    publish();
+    alloc.setChannelLimits(9, 0, 2);
+    alloc.sync(snap);
+    for (int k = 0; k < N - 2; ++k) {
+        const int i = alloc.allocate(0, 60 + k);
+        TEST_ASSERT_TRUE(i != 3 && i != 6);
+    }
+    TEST_ASSERT_EQUAL_INT(3, alloc.allocate(0, 70));     // only reserved ones left: quietest
+}
+
+// More note-ons than voices in one block: no slot is handed out twice, reserved free voices
+// stay free, and the overflow note gets -1 instead of a round-robin slot
+void test_overflow_fails_instead_of_reusing() {
+    voice(0, 2, 30, 0.5f);
+    voice(1, 2, 31, 0.6f);
+    publish();
+    alloc.setChannelLimits(9, 0, 1);
+    alloc.sync(snap);
+    bool seen[N] = {};
+    int  got = 0;
+    for (int k = 0; k < N + 4; ++k) {
+        const int i = alloc.allocate(0, 60 + k);
+        if (i < 0) continue;
+        TEST_ASSERT_FALSE(seen[i]);
+        seen[i] = true;
+        got++;
+    }
+    TEST_ASSERT_EQUAL_INT(N - 1, got);                  // one voice stays channel 9's
+    const int d = alloc.allocate(9, 36);
+    TEST_ASSERT_TRUE(d >= 0 && !seen[d]);
+}
+
+// Cost with every voice sounding: a new snapshot each block (sync = copy + heapify, once
+// per block with note-ons) and a 4-note chord popped from it, against one full scan per
+// note-on (the old findWorstVoice without its per-voice updateScore()).
+// Prints ns on the host; no pass/fail on time, only that the heap finds the scan's victim.
+template <int V>
+static void benchAllocator() {
+    static ScoreSnapshot<V>  sn;
+    static VoiceAllocator<V> al;
+    static VoiceScore        sc[V];
+    al = VoiceAllocator<V>();
+    al.setPolicy(STEAL_RELEASE_FIRST);
+
+    std::mt19937 rng(V);
+    std::uniform_real_distribution<float> lv(0.0f, 1.0f);
+    const int blocks = 20000;
+    double tSync = 0.0, tHeap = 0.0, tScan = 0.0;
+    volatile int sink = 0;
+    for (int b = 0; b < blocks; ++b) {
+        for (int i = 0; i < V; ++i) sc[i] = { lv(rng), 1000u, (uint8_t)(i & 15), (uint8_t)(36 + i % 64), 1, (uint8_t)((i % 3) == 0) };
+        memcpy(sn.beginWrite(), sc, sizeof(sc));
+        sn.endWrite();
+
+        auto t0 = std::chrono::steady_clock::now();
+        al.sync(sn);
+        auto ts = std::chrono::steady_clock::now();
+        int first = -1;
+        for (int k = 0; k < 4; ++k) {
+            const int i = al.allocate(0, 60 + k);
+            if (k == 0) first = i;
+            sink += i;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        // old way: one linear pass per note-on over every voice
+        int worst = -1;
+        for (int k = 0; k < 4; ++k) {
+            float wk = 1e30f;
+            for (int i = 0; i < V; ++i) {
+                const float key = sc[i].releasing ? sc[i].level : sc[i].level + 1000.0f;
+                if (key < wk) { wk = key; worst = i; }
+            }
+            sink += worst;
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        tSync += std::chrono::duration<double, std::nano>(ts - t0).count();
+        tHeap += std::chrono::duration<double, std::nano>(t1 - ts).count();
+        tScan += std::chrono::duration<double, std::nano>(t2 - t1).count();
+        // first victim of the chord = quietest released voice = the scan's pick
+        float best = 1e30f; int ref = -1;
+        for (int i = 0; i < V; ++i) {
+            const float key = sc[i].releasing ? sc[i].level : sc[i].level + 1000.0f;
+            if (key < best) { best = key; ref = i; }
+        }
+        TEST_ASSERT_EQUAL_INT(ref, first);
+    }
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d voices: sync %.0f ns, allocate %.0f ns/note-on, full scan %.0f ns/note-on",
+             V, tSync / blocks, tHeap / blocks / 4, tScan / blocks / 4);
+    TEST_MESSAGE(msg);
+}
+
+void test_bench_64_voices()  { benchAllocator<64>(); }
+void test_bench_128_voices() { benchAllocator<128>(); }
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_free_voices_first);
+    RUN_TEST(test_steals_quietest);
+    RUN_TEST(test_cap_steals_within_channel);
+    RUN_TEST(test_cap_restarts_earliest_hand_out);
+    RUN_TEST(test_reserve_keeps_free_voices);
+    RUN_TEST(test_reserve_protects_sounding_voices);
+    RUN_TEST(test_overflow_fails_instead_of_reusing);
+    RUN_TEST(test_bench_64_voices);
+    RUN_TEST(test_bench_128_voices);
+    return UNITY_END();
+}
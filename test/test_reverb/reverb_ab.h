@@ -0,0 +1,14 @@
+/*
+ * The same FxReverb built twice: reverb_full.cpp without and reverb_half.cpp with
+ * REVERB_HALF_RATE, each in its own namespace so both tanks link into one test.
+ */
+
+#pragma once
+
+// mono send in (blocks * DMA_BUFFER_LEN samples), wet stereo out; time/damping as setTime()/setDamping()
+namespace rev_full {
+  void render(const float* in, float* outL, float* outR, int blocks, float time, float damping);
+}
+namespace rev_half {
+  void render(const float* in, float* outL, float* outR, int blocks, float time, float damping);
+}
@@ -0,0 +1,26 @@
+#include <Arduino.h>
+#include "config.h"
+#include "misc.h"
+#include "reverb_ab.h"
+
+#define REVERB_HALF_RATE     // this build only
+
+namespace rev_half {
+#include "fx_reverb.h"
+
+void render(const float* in, float* outL, float* outR, int blocks, float time, float damping) {
+  FxReverb rev;
+  rev.init();
+  rev.setTime(time);
+  rev.setDamping(damping);
+  rev.setPreDelayTime(0.0f);
+  for (int b = 0; b < blocks; ++b) {
+    float* l = outL + b * DMA_BUFFER_LEN;
+    float* r = outR + b * DMA_BUFFER_LEN;
+    memcpy(l, in + b * DMA_BUFFER_LEN, sizeof(float) * DMA_BUFFER_LEN);
+    memcpy(r, in + b * DMA_BUFFER_LEN, sizeof(float) * DMA_BUFFER_LEN);
+    rev.processBlock(l, r);
+  }
+}
+
+}
@@ -0,0 +1,136 @@
+/*
+ * FxReverb A/B: half-rate tank (REVERB_HALF_RATE) against the full-rate one.
+ * Same impulse into both builds, brightest damping; the tails must have the same
+ * level in the pass band and the half-rate one must be band-limited above ~12 kHz.
+ * pio test -e native -f test_reverb
+ */
+
+#include <unity.h>
+#include <vector>
+#include <complex>
+#include <Arduino.h>
+#include "config.h"
+#include "reverb_ab.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const int BLOCKS   = 3 * SAMPLE_RATE / DMA_BUFFER_LEN;   // ~3 s
+static const int TAIL_AT  = SAMPLE_RATE / 4;                    // skip the first 250 ms
+static const int FFT_LEN  = 1 << 16;                            // ~1.5 s of tail
+
+static std::vector<float> fullL, fullR, halfL, halfR;
+static std::vector<double> fullPow, halfPow;
+
+static void fft(std::vector<std::complex<double>>& a) {
+    const int n = (int)a.size();
+    for (int i = 1, j = 0; i < n; ++i) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        const std::complex<double> wl = std::polar(1.0, -2.0 * M_PI / len);
+        for (int i = 0; i < n; i += len) {
+            std::complex<double> w = 1.0;
+            for (int k = 0; k < len / 2; ++k, w *= wl) {
+                const std::complex<double> u = a[i + k], v = a[i + k + len / 2] * w;
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+            }
+        }
+    }
+}
+
+// Hann-windowed power spectrum of the tail, L and R summed
+static std::vector<double> tailPower(const std::vector<float>& l, const std::vector<float>& r) {
+    std::vector<double> p(FFT_LEN / 2, 0.0);
+    for (const std::vector<float>* ch : {&l, &r}) {
+        std::vector<std::complex<double>> a(FFT_LEN);
+        for (int i = 0; i < FFT_LEN; ++i) {
+            const double w = 0.5 - 0.5 * cos(2.0 * M_PI * i / FFT_LEN);
+            a[i] = w * (*ch)[TAIL_AT + i];
+        }
+        fft(a);
+        for (int k = 0; k < FFT_LEN / 2; ++k) p[k] += std::norm(a[k]);
+    }
+    return p;
+}
+
+static double band(const std::vector<double>& p, double f0, double f1) {
+    const double hz = double(SAMPLE_RATE) / FFT_LEN;
+    double e = 0.0;
+    for (int k = int(f0 / hz); k < int(f1 / hz) && k < (int)p.size(); ++k) e += p[k];
+    return e;
+}
+
+static double dB(double a, double b) { return 10.0 * log10(a / b); }
+
+static void renderBoth() {
+    if (!fullPow.empty()) return;
+    const int n = BLOCKS * DMA_BUFFER_LEN;
+    std::vector<float> in(n, 0.0f);
+    in[0] = 1.0f;
+    fullL.resize(n); fullR.resize(n); halfL.resize(n); halfR.resize(n);
+    // damping 1 = no in-loop lowpass: the most high end the tank can produce
+    rev_full::render(in.data(), fullL.data(), fullR.data(), BLOCKS, 0.8f, 1.0f);
+    rev_half::render(in.data(), halfL.data(), halfR.data(), BLOCKS, 0.8f, 1.0f);
+    fullPow = tailPower(fullL, fullR);
+    halfPow = tailPower(halfL, halfR);
+}
+
+// tail level: pass band (125 Hz..8 kHz) within 1 dB, octave bands within 2 dB
+void test_tail_level_matches() {
+    renderBoth();
+    const double pass = dB(band(halfPow, 125.0, 8000.0), band(fullPow, 125.0, 8000.0));
+    char msg[96];
+    snprintf(msg, sizeof(msg), "pass band 125 Hz..8 kHz: half - full = %+.2f dB", pass);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(fabs(pass) < 1.0);
+    for (double f = 125.0; f < 8000.0; f *= 2.0) {
+        const double d = dB(band(halfPow, f, 2.0 * f), band(fullPow, f, 2.0 * f));
+        snprintf(msg, sizeof(msg), "  %5.0f..%5.0f Hz: %+.2f dB", f, 2.0 * f, d);
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(fabs(d) < 2.0);
+    }
+}
+
+// half rate: little energy above 12 kHz, next to nothing above 16 kHz (half-band stop band)
+void test_half_rate_band_limit() {
+    renderBoth();
+    const double total = band(halfPow, 0.0, SAMPLE_RATE / 2);
+    const double hi12 = dB(band(halfPow, 12000.0, SAMPLE_RATE / 2), total);
+    const double hi16 = dB(band(halfPow, 16000.0, SAMPLE_RATE / 2), total);
+    const double full12 = dB(band(fullPow, 12000.0, SAMPLE_RATE / 2), band(fullPow, 0.0, SAMPLE_RATE / 2));
+    char msg[128];
+    snprintf(msg, sizeof(msg), "energy above 12 kHz: half %.1f dB, full %.1f dB; above 16 kHz: half %.1f dB",
+             hi12, full12, hi16);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(hi12 < -20.0);
+    TEST_ASSERT_TRUE(hi16 < -50.0);
+    TEST_ASSERT_TRUE(hi12 < full12 - 10.0);
+}
+
+// the tail decays and stays finite in both builds
+void test_tails_decay() {
+    renderBoth();
+    auto rms = [](const std::vector<float>& x, int from, int len) {
+        double e = 0.0;
+        for (int i = from; i < from + len; ++i) e += double(x[i]) * x[i];
+        return sqrt(e / len);
+    };
+    const int w = SAMPLE_RATE / 10;
+    for (const std::vector<float>* x : {&fullL, &halfL}) {
+        for (float v : *x) TEST_ASSERT_TRUE(std::isfinite(v));
+        TEST_ASSERT_TRUE(rms(*x, (int)x->size() - w, w) < 0.1 * rms(*x, SAMPLE_RATE / 10, w));
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_tail_level_matches);
+    RUN_TEST(test_half_rate_band_limit);
+    RUN_TEST(test_tails_decay);
+    return UNITY_END();
+}
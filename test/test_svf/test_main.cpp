@@ -0,0 +1,105 @@
+/*
+ * SVF on the host: defaults, stability at FILTER_MAX_Q under fast per-block cutoff ramps
+ * over 20 Hz..20 kHz, and the cost of a voice-block against the biquad.
+ * pio test -e native -f test_svf
+ */
+
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include "svf.h"
+
+static unsigned seed = 1;
+
+static float noise() {
+    seed = seed * 1664525u + 1013904223u;
+    return (float)(seed >> 9) * (2.0f / 8388608.0f) - 1.0f;
+}
+
+// cutoff position of block b: full 20 Hz..20 kHz sweeps of `period` blocks, up then down
+static float sweepPos(int b, int period) {
+    float t = (float)(b % period) / (float)(period - 1);
+    if ((b / period) & 1) t = 1.0f - t;
+    return SvfCalc::freqToLutPos(20.0f * powf(1000.0f, t));
+}
+
+void setUp() {
+    SvfCalc::ensureLUT();
+    BiquadCalc::ensureLUT();
+}
+
+void tearDown() {}
+
+// a default-constructed filter (20 kHz, Q 0.707) passes DC
+void test_default_ctor_passes_dc() {
+    SvfFilterInternalCoeffs f;
+    float y = 0.0f;
+    for (int i = 0; i < 2000; ++i) y = f.process(1.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.0f, y);
+}
+
+// Q = FILTER_MAX_Q, noise in, the cutoff ramps to a new position every block: slow sweeps,
+// one full sweep every 8 blocks and jumps between the two ends. Output stays finite and
+// bounded, and rings down once the input stops.
+void test_max_q_sweeps_stay_bounded() {
+    const float k = SvfCalc::qToLutPos(FILTER_MAX_Q);
+    const int   periods[] = { 400, 8, 2 };
+    for (int period : periods) {
+        SvfFilterInternalCoeffs m, s;
+        float peak = 0.0f;
+        for (int b = 0; b < 4000; ++b) {
+            const float pos = sweepPos(b, period);
+            m.rampToLutPos(pos, k, 128);
+            s.rampToLutPos(pos, k, 128);
+            for (int i = 0; i < 128; ++i) {
+                const float y = m.process(noise());
+                float l = noise(), r = 0.5f * noise();
+                s.processLR(&l, &r);
+                TEST_ASSERT_TRUE(isfinite(y) && isfinite(l) && isfinite(r));
+                peak = fmaxf(peak, fmaxf(fabsf(y), fmaxf(fabsf(l), fabsf(r))));
+            }
+        }
+        TEST_ASSERT_TRUE(peak < 2.0f * FILTER_MAX_Q);
+
+        // silence: 1 s at the lowest cutoff (longest ring) decays to nothing
+        m.rampToLutPos(0.0f, k, 128);
+        float y = 1.0f;
+        for (int i = 0; i < SAMPLE_RATE; ++i) y = m.process(0.0f);
+        TEST_ASSERT_TRUE(fabsf(y) < 1e-4f);
+    }
+}
+
+// one voice-block with a per-block cutoff ramp: SVF vs biquad, host ns (printed, not checked)
+void test_bench_svf_vs_biquad() {
+    SvfFilterInternalCoeffs    s;
+    BiquadFilterInternalCoeffs q;
+    const int blocks = 100000;
+    float acc = 0.0f;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int b = 0; b < blocks; ++b) {
+        s.rampToLutPos(10.0f + (b & 31), SvfCalc::qToLutPos(2.0f), 128);
+        for (int i = 0; i < 128; ++i) acc += s.process((float)(i & 7));
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int b = 0; b < blocks; ++b) {
+        q.rampToLutPos(10.0f + (b & 31), BiquadCalc::qToLutPos(2.0f), 128);
+        for (int i = 0; i < 128; ++i) acc += q.process((float)(i & 7));
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(isfinite(acc));
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "voice-block (128 samples, ramped): svf %.0f ns, biquad %.0f ns",
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / blocks,
+             std::chrono::duration<double, std::nano>(t2 - t1).count() / blocks);
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_default_ctor_passes_dc);
+    RUN_TEST(test_max_q_sweeps_stay_bounded);
+    RUN_TEST(test_bench_svf_vs_biquad);
+    return UNITY_END();
+}
@@ -0,0 +1,123 @@
+/*
+ * VoiceIndex on the host: (channel, note) and exclusive-class masks, choke table overflow,
+ * and a drum-pattern benchmark of the note-on choke lookup against a scan of every voice.
+ * pio test -e native -f test_voice_index
+ */
+
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include "voice_index.h"
+
+constexpr int N = 64;
+
+static VoiceIndex<N> idx;
+
+void setUp() { idx.clear(); }
+void tearDown() {}
+
+static int popcount(uint64_t m) { return __builtin_popcountll(m); }
+
+void test_channel_and_note_masks() {
+    idx.add(3, 9, 42);
+    idx.add(5, 9, 42);
+    idx.add(7, 9, 36);
+    idx.add(8, 1, 42);
+    TEST_ASSERT_TRUE(idx.note(9, 42) == (VoiceIndex<N>::bit(3) | VoiceIndex<N>::bit(5)));
+    TEST_ASSERT_EQUAL_INT(3, popcount(idx.channel(9)));
+    idx.remove(5);
+    TEST_ASSERT_TRUE(idx.note(9, 42) == VoiceIndex<N>::bit(3));
+    idx.moveNote(3, 44);
+    TEST_ASSERT_TRUE(idx.note(9, 44) == VoiceIndex<N>::bit(3));
+    TEST_ASSERT_TRUE(idx.note(9, 42) == 0);
+}
+
+// hi-hat pedal / closed / open share a class: one lookup returns exactly those slots
+void test_exclusive_class_lookup() {
+    idx.add(0, 9, 42, 1);
+    idx.add(1, 9, 46, 1);
+    idx.add(2, 9, 36);
+    idx.add(3, 4, 42, 1);               // same class on another channel
+    TEST_ASSERT_TRUE(idx.exclusive(9, 1) == (VoiceIndex<N>::bit(0) | VoiceIndex<N>::bit(1)));
+    idx.add(1, 9, 38);                  // slot re-used without a class: leaves the class
+    TEST_ASSERT_TRUE(idx.exclusive(9, 1) == VoiceIndex<N>::bit(0));
+    idx.remove(0);
+    TEST_ASSERT_TRUE(idx.exclusive(9, 1) == 0);
+}
+
+// more classes than CHOKE_CLASSES_PER_CH: the rest go to the overflow mask, which every
+// lookup on the channel includes (the caller filters by class)
+void test_class_overflow() {
+    for (int c = 1; c <= CHOKE_CLASSES_PER_CH + 2; ++c) idx.add(c, 9, 40 + c, (uint16_t)c);
+    for (int c = 1; c <= CHOKE_CLASSES_PER_CH + 2; ++c)
+        TEST_ASSERT_TRUE(idx.exclusive(9, (uint16_t)c) & VoiceIndex<N>::bit(c));
+    const uint64_t ov = idx.exclusive(9, 999);
+    TEST_ASSERT_EQUAL_INT(2, popcount(ov));
+    for (int c = 1; c <= CHOKE_CLASSES_PER_CH + 2; ++c) idx.remove(c);
+    TEST_ASSERT_TRUE(idx.exclusive(9, 1) == 0 && idx.exclusive(9, 999) == 0);
+}
+
+// 16th-note hi-hats (closed, every 4th open, both class 1) with kick and snare on channel 10,
+// a pad on 4 other channels filling the rest of the voices. Whole note-on path of the pattern:
+// choke (table: mask lookup + class slots, keeping the index up to date; old way: a pass
+// over every voice) and starting the note. A choked hat is gone by the next 16th.
+struct DrumSlot { bool active; uint8_t ch; uint16_t cls; };
+
+template <bool UseTable>
+static double runPattern(int steps, long& chokes) {
+    static DrumSlot voices[N];
+    idx.clear();
+    for (int i = 0; i < N; ++i) {
+        voices[i] = { true, (uint8_t)(i % 4), 0 };
+        idx.add(i, voices[i].ch, (uint8_t)(48 + i));
+    }
+    int next = 0;
+    chokes = 0;
+    auto start = [&](uint8_t note, uint16_t cls) {
+        const int slot = next;
+        next = (next + 1) % N;
+        voices[slot] = { true, 9, cls };
+        if (UseTable) idx.add(slot, 9, note, cls);
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s) {
+        if (UseTable) {
+            for (uint64_t m = idx.exclusive(9, 1); m; m &= m - 1) {
+                const int i = __builtin_ctzll(m);
+                if (voices[i].active && voices[i].cls == 1) { voices[i].active = false; chokes++; }
+                idx.remove(i);
+            }
+        } else {
+            for (int i = 0; i < N; ++i)
+                if (voices[i].active && voices[i].ch == 9 && voices[i].cls == 1) { voices[i].active = false; chokes++; }
+        }
+        start((s % 4 == 2) ? 46 : 42, 1);
+        if (s % 4 == 0) start((s % 8 == 0) ? 36 : 38, 0);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / steps;
+}
+
+void test_bench_drum_pattern() {
+    const int steps = 1000000;
+    long cTable = 0, cScan = 0;
+    const double tTable = runPattern<true>(steps, cTable);
+    const double tScan  = runPattern<false>(steps, cScan);
+    TEST_ASSERT_EQUAL_INT(cScan, cTable);
+    TEST_ASSERT_EQUAL_INT(steps - 1, cTable);       // every hat chokes the previous one
+
+    char msg[140];
+    snprintf(msg, sizeof(msg), "%d voices, drum pattern note-on (choke + start): table %.1f ns, full scan %.1f ns",
+             N, tTable, tScan);
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_channel_and_note_masks);
+    RUN_TEST(test_exclusive_class_lookup);
+    RUN_TEST(test_class_overflow);
+    RUN_TEST(test_bench_drum_pattern);
+    return UNITY_END();
+}